@@ -0,0 +1,122 @@
+#include "BackgroundCache.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QPainter>
+
+#include "Resampler.h"
+#include "MemoryBudget.h"
+
+//TODO magic size, about 12 full pages of 2480x3508 ARGB32
+const static qsizetype BG_CACHE_MAX_COST = 400 * 1024 * 1024;
+
+BackgroundCache::BackgroundCache()
+{
+    m_cache.setMaxCost(BG_CACHE_MAX_COST);
+    MemoryBudget::instance()->addReclaimer([this]() {
+        QMutexLocker locker(&m_mutex);
+        const qint64 bytes = m_cache.totalCost();
+        m_cache.clear();
+        locker.unlock();
+        MemoryBudget::instance()->releaseRetained(bytes);
+        return bytes;
+    });
+}
+
+BackgroundCache *BackgroundCache::instance()
+{
+    static BackgroundCache s_cache;
+    return &s_cache;
+}
+
+BackgroundLayer BackgroundCache::layer(const QString &file, const QSize &pageSize, QImage::Format format,
+                                       const QByteArray &data)
+{
+    const QFileInfo info(file);
+    if (file.isEmpty() || (data.isEmpty() && !info.exists()) || pageSize.isEmpty()) {
+        return BackgroundLayer();
+    }
+    //packed data doesn't change under the same name, the pack is rewritten as a whole
+    //draft layers are kept apart, see Resampler::FastScope
+    const QString key = QString("%1|%2x%3|%4|%5|%6")
+                            .arg(info.absoluteFilePath())
+                            .arg(pageSize.width())
+                            .arg(pageSize.height())
+                            .arg(static_cast<int>(format))
+                            .arg(data.isEmpty() ? info.lastModified().toMSecsSinceEpoch() : data.size())
+                            .arg(Resampler::fastMode() ? 1 : 0);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto *cached = m_cache.object(key)) {
+            return *cached;
+        }
+    }
+
+    QImage img;
+    if (data.isEmpty() ? !img.load(file) : !img.loadFromData(data)) {
+        qDebug()<<Q_FUNC_INFO<<"load background error "<<file;
+        return BackgroundLayer();
+    }
+    img = Resampler::scaledToHeight(img, pageSize.height());
+
+    //same crop as the page was drawn before, right part of the image if it's wider than the page
+    const QRect src(qMax(qAbs(img.width() - pageSize.width()), 0),
+                    qMax(qAbs(img.height() - pageSize.height()), 0),
+                    img.width(),
+                    img.height());
+    const QRect dst = QRect(QPoint(0, 0), src.intersected(img.rect()).size());
+
+    auto *bg = new BackgroundLayer;
+    bg->opaque = !img.hasAlphaChannel()
+                 && dst.width() >= pageSize.width()
+                 && dst.height() >= pageSize.height();
+    if (bg->opaque) {
+        bg->image = img.copy(QRect(src.topLeft(), pageSize)).convertToFormat(format);
+    } else {
+        bg->image = QImage(pageSize, QImage::Format_ARGB32_Premultiplied);
+        bg->image.fill(Qt::GlobalColor::transparent);
+        QPainter p(&bg->image);
+        p.drawImage(QPoint(0, 0), img, src);
+        p.end();
+    }
+
+    const BackgroundLayer ret = *bg;
+    const qint64 cost = ret.image.sizeInBytes();
+    //made from media decoded by the render on this thread, its reservation holds the bytes already
+    if (!MemoryBudget::instance()->retain(cost, true)) {
+        qDebug()<<Q_FUNC_INFO<<"background layer over the memory budget "<<file;
+        delete bg;
+        return ret;
+    }
+    QMutexLocker locker(&m_mutex);
+    //the cost of the layers it evicts is given back, all of it if bg is too large to cache
+    const qint64 before = m_cache.totalCost();
+    if (!m_cache.insert(key, bg, cost)) {
+        qDebug()<<Q_FUNC_INFO<<"background layer too large to cache "<<file;
+    }
+    const qint64 freed = before + cost - m_cache.totalCost();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(freed);
+    return ret;
+}
+
+void BackgroundCache::setMaxCost(qsizetype bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 before = m_cache.totalCost();
+    m_cache.setMaxCost(bytes);
+    const qint64 freed = before - m_cache.totalCost();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(freed);
+}
+
+void BackgroundCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 bytes = m_cache.totalCost();
+    m_cache.clear();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(bytes);
+}
@@ -0,0 +1,44 @@
+#ifndef BACKGROUNDCACHE_H
+#define BACKGROUNDCACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+struct BackgroundLayer
+{
+    QImage image;
+    //true if image covers the whole page and has no alpha, so it can be blit with CompositionMode_Source
+    bool opaque = false;
+};
+
+/*
+ * Background images already scaled and cropped to the page rect, shared by all pages.
+ * Its cost is retained in the MemoryBudget, which clears it when a render doesn't fit,
+ * an insert over the budget is dropped.
+ * Thread safe, returned images are implicitly shared with the cache.
+ */
+class BackgroundCache
+{
+public:
+    static BackgroundCache *instance();
+
+    //data is the content of file if it's read from a MediaPack, file is only the key then
+    BackgroundLayer layer(const QString &file, const QSize &pageSize, QImage::Format format,
+                          const QByteArray &data = QByteArray());
+
+    void setMaxCost(qsizetype bytes);
+
+    void clear();
+
+private:
+    BackgroundCache();
+    Q_DISABLE_COPY(BackgroundCache)
+
+private:
+    QMutex m_mutex;
+    QCache<QString, BackgroundLayer> m_cache;
+};
+
+#endif // BACKGROUNDCACHE_H
@@ -0,0 +1,333 @@
+#include "BatchScheduler.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QMutexLocker>
+
+#include "Coroutine.h"
+#include "MediaPipeline.h"
+
+//wait time of an idle worker before looking for work again
+const static int IDLE_WAIT_MS = 20;
+
+BatchScheduler::BatchScheduler(QObject *parent)
+    : QObject(parent)
+    , m_threadCount(QThread::idealThreadCount())
+{
+
+}
+
+BatchScheduler::~BatchScheduler()
+{
+    cancel();
+    for (const auto &w : m_workers) {
+        if (w->thread) {
+            w->thread->wait();
+            delete w->thread;
+            w->thread = nullptr;
+        }
+    }
+    m_workers.clear();
+    if (m_downloadThread) {
+        m_downloadThread->wait();
+        delete m_downloadThread;
+        delete m_pipeline;
+    }
+}
+
+QStringList BatchScheduler::collectBooks(const QStringList &inputs)
+{
+    QStringList list;
+    for (const auto &it : inputs) {
+        const QFileInfo info(it);
+        if (info.isDir()) {
+            const QDir dir(info.absoluteFilePath());
+            const auto names = dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name);
+            for (const auto &name : names) {
+                list.append(dir.absoluteFilePath(name));
+            }
+        } else if (info.isFile()) {
+            list.append(info.absoluteFilePath());
+        } else {
+            qDebug()<<Q_FUNC_INFO<<"Ignore invalid input "<<it;
+        }
+    }
+    list.removeDuplicates();
+    return list;
+}
+
+QList<BatchBook> BatchScheduler::booksFor(const QStringList &jsonFiles, const QString &outRoot)
+{
+    QList<BatchBook> books;
+    const QDir root(outRoot);
+    for (const auto &json : jsonFiles) {
+        BatchBook book;
+        book.jsonPath   = json;
+        book.mediaPath  = root.absoluteFilePath(QFileInfo(json).completeBaseName());
+        book.outPath    = book.mediaPath + "/out";
+        books.append(book);
+    }
+    return books;
+}
+
+void BatchScheduler::setThreadCount(int count)
+{
+    m_threadCount = count;
+}
+
+void BatchScheduler::setDownloadEnabled(bool enabled)
+{
+    m_download = enabled;
+}
+
+bool BatchScheduler::start(const QList<BatchBook> &books)
+{
+    if (isRunning()) {
+        qDebug()<<Q_FUNC_INFO<<"batch is running";
+        return false;
+    }
+    if (books.isEmpty()) {
+        qDebug()<<Q_FUNC_INFO<<"no book to render";
+        return false;
+    }
+    for (const auto &w : m_workers) {
+        if (w->thread) {
+            w->thread->wait();
+            delete w->thread;
+        }
+    }
+    m_workers.clear();
+    if (m_downloadThread) {
+        m_downloadThread->wait();
+        delete m_downloadThread;
+        delete m_pipeline;
+        m_downloadThread = nullptr;
+        m_pipeline = nullptr;
+    }
+
+    const int bookCnt = books.size();
+    m_books = books;
+    m_bookData.assign(bookCnt, BookData());
+    m_bookDone.reset(new std::atomic<int>[bookCnt]);
+    m_bookTotal.reset(new std::atomic<int>[bookCnt]);
+    m_bookTimer.reset(new QElapsedTimer[bookCnt]);
+    for (int i=0; i<bookCnt; ++i) {
+        m_bookDone[i] = 0;
+        m_bookTotal[i] = 0;
+    }
+
+    const int threads = m_threadCount > 0 ? m_threadCount : QThread::idealThreadCount();
+    for (int i=0; i<threads; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    //loading tasks round robin, pages are queued once a book is parsed
+    if (!m_download) {
+        for (int i=0; i<bookCnt; ++i) {
+            m_workers.at(i % threads)->tasks.push_back(Task{i, Task::Load});
+        }
+    }
+
+    //a download counts as pending until the loading of its book is queued
+    m_pending.storeRelease(bookCnt);
+    m_done.storeRelease(0);
+    m_total.storeRelease(0);
+    m_cancel.storeRelease(0);
+    m_running.storeRelease(threads);
+    m_timer.start();
+
+    qDebug()<<Q_FUNC_INFO<<"render "<<bookCnt<<" books with "<<threads<<" threads";
+
+    for (int i=0; i<threads; ++i) {
+        auto *thread = QThread::create([this, i]() {
+            runWorker(i);
+        });
+        thread->setObjectName(QString("BatchWorker-%1").arg(i));
+        m_workers.at(i)->thread = thread;
+        thread->start();
+    }
+    if (m_download) {
+        startDownloads();
+    }
+    return true;
+}
+
+void BatchScheduler::cancel()
+{
+    m_cancel.storeRelease(1);
+    m_wake.wakeAll();
+    //replies are aborted on their own thread, never run if the downloads are done already
+    if (m_pipeline) {
+        QMetaObject::invokeMethod(m_pipeline, &MediaPipeline::cancel);
+    }
+}
+
+bool BatchScheduler::isRunning() const
+{
+    return m_running.loadAcquire() > 0;
+}
+
+void BatchScheduler::push(int worker, const QList<Task> &tasks)
+{
+    if (tasks.isEmpty()) {
+        return;
+    }
+    m_pending.fetchAndAddOrdered(tasks.size());
+    {
+        auto &w = m_workers.at(worker);
+        QMutexLocker locker(&w->mutex);
+        for (const auto &t : tasks) {
+            w->tasks.push_back(t);
+        }
+    }
+    m_wake.wakeAll();
+}
+
+bool BatchScheduler::pop(int worker, Task &task)
+{
+    auto &w = m_workers.at(worker);
+    QMutexLocker locker(&w->mutex);
+    if (w->tasks.empty()) {
+        return false;
+    }
+    //owner works LIFO at the back, thieves take from the front
+    task = w->tasks.back();
+    w->tasks.pop_back();
+    return true;
+}
+
+bool BatchScheduler::steal(int thief, Task &task)
+{
+    const int cnt = static_cast<int>(m_workers.size());
+    for (int i=1; i<cnt; ++i) {
+        auto &w = m_workers.at((thief + i) % cnt);
+        QMutexLocker locker(&w->mutex);
+        if (!w->tasks.empty()) {
+            task = w->tasks.front();
+            w->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchScheduler::runWorker(int worker)
+{
+    //one renderer per thread, switched between books when stealing pages
+    BookRenderer renderer;
+    int curBook = -1;
+
+    while (!m_cancel.loadAcquire()) {
+        if (Task task; pop(worker, task) || steal(worker, task)) {
+            if (task.page == Task::Load) {
+                loadBook(worker, task);
+            } else {
+                renderPage(renderer, curBook, task);
+            }
+            if (m_pending.fetchAndSubOrdered(1) == 1) {
+                m_wake.wakeAll();
+            }
+            continue;
+        }
+        QMutexLocker locker(&m_idleMutex);
+        if (m_pending.loadAcquire() == 0) {
+            break;
+        }
+        m_wake.wait(&m_idleMutex, IDLE_WAIT_MS);
+    }
+
+    if (m_running.fetchAndSubOrdered(1) == 1) {
+        Q_EMIT finished(m_done.loadAcquire(), m_timer.elapsed());
+    }
+}
+
+void BatchScheduler::startDownloads()
+{
+    m_downloadThread = new QThread;
+    m_downloadThread->setObjectName("BatchDownload");
+    m_pipeline = new MediaPipeline;
+    m_pipeline->moveToThread(m_downloadThread);
+    m_downloadThread->start();
+
+    QMetaObject::invokeMethod(m_pipeline, [this]() {
+        Coro::start([](BatchScheduler *self) -> Coro::Task<void> {
+            const int workers = static_cast<int>(self->m_workers.size());
+            for (int book=0; book<self->m_books.size() && !self->m_cancel.loadAcquire(); ++book) {
+                const auto &b = self->m_books.at(book);
+                self->m_bookTimer[book].start();
+                const auto error = QObject::connect(self->m_pipeline, &MediaPipeline::pipelineError,
+                                                    self->m_pipeline, [self, book](const QString &msg) {
+                    Q_EMIT self->bookError(book, msg);
+                });
+                co_await self->m_pipeline->download(b.jsonPath, b.mediaPath);
+                QObject::disconnect(error);
+
+                //loaded even if some media failed, the renderer skips broken files
+                self->push(book % workers, QList<Task>() << Task{book, Task::Load});
+                if (self->m_pending.fetchAndSubOrdered(1) == 1) {
+                    self->m_wake.wakeAll();
+                }
+            }
+        }(this), [this]() {
+            m_downloadThread->quit();
+        });
+    });
+}
+
+void BatchScheduler::loadBook(int worker, const Task &task)
+{
+    const auto &book = m_books.at(task.book);
+    //already running since the download
+    if (!m_bookTimer[task.book].isValid()) {
+        m_bookTimer[task.book].start();
+    }
+
+    BookRenderer loader;
+    if (!loader.load(book.jsonPath, book.mediaPath)) {
+        Q_EMIT bookError(task.book, QString("Load book [%1] error!").arg(book.jsonPath));
+        return;
+    }
+    QDir dir;
+    if (!dir.mkpath(book.outPath)) {
+        Q_EMIT bookError(task.book, QString("Error to create path [%1]!").arg(book.outPath));
+        return;
+    }
+    m_bookData[task.book] = loader.book();
+
+    const int pages = loader.pageCount();
+    m_bookTotal[task.book] = pages;
+    m_total.fetchAndAddOrdered(pages);
+    Q_EMIT bookProgress(task.book, 0, pages);
+
+    //reversed, so the owner renders from the first page and thieves take the last ones
+    QList<Task> tasks;
+    tasks.reserve(pages);
+    for (int i=pages-1; i>=0; --i) {
+        tasks.append(Task{task.book, i});
+    }
+    push(worker, tasks);
+}
+
+void BatchScheduler::renderPage(BookRenderer &renderer, int &curBook, const Task &task)
+{
+    if (curBook != task.book) {
+        renderer.setBook(m_bookData.at(task.book));
+        curBook = task.book;
+    }
+    if (!renderer.save(task.page, m_books.at(task.book).outPath)) {
+        Q_EMIT bookError(task.book, QString("Save page %1 of [%2] error!")
+                                        .arg(task.page)
+                                        .arg(m_books.at(task.book).jsonPath));
+    }
+
+    const int bookDone  = ++m_bookDone[task.book];
+    const int bookTotal = m_bookTotal[task.book];
+    const int done      = m_done.fetchAndAddOrdered(1) + 1;
+
+    Q_EMIT bookProgress(task.book, bookDone, bookTotal);
+    if (bookDone == bookTotal) {
+        Q_EMIT bookFinished(task.book, m_bookTimer[task.book].elapsed());
+    }
+    Q_EMIT progress(done, m_total.loadAcquire(), done * 1000.0 / qMax<qint64>(1, m_timer.elapsed()));
+}
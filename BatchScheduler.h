@@ -0,0 +1,125 @@
+#ifndef BATCHSCHEDULER_H
+#define BATCHSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "BookRenderer.h"
+
+class QThread;
+class MediaPipeline;
+
+struct BatchBook
+{
+    QString jsonPath;
+    QString mediaPath;
+    QString outPath;
+};
+
+/*
+ * Renders a whole class of books on a shared pool of worker threads.
+ * Every worker owns a task deque, loading a book pushes its pages to the loader's deque
+ * and idle workers steal from the other deques, so long books don't leave cores idle.
+ * With downloads enabled the media of the books are fetched one book after another by a
+ * MediaPipeline on its own thread, which queues the loading of each book once its media are
+ * done, so the downloads of some books overlap the rendering of others without holding a worker.
+ */
+class BatchScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BatchScheduler(QObject *parent = nullptr);
+    virtual ~BatchScheduler();
+
+    //json files, or directories of json files
+    static QStringList collectBooks(const QStringList &inputs);
+
+    //media in <outRoot>/<book name>, images in <outRoot>/<book name>/out
+    static QList<BatchBook> booksFor(const QStringList &jsonFiles, const QString &outRoot);
+
+    void setThreadCount(int count);
+
+    //download the media of every book before loading it, off by default
+    void setDownloadEnabled(bool enabled);
+
+    bool start(const QList<BatchBook> &books);
+
+    void cancel();
+
+    bool isRunning() const;
+
+Q_SIGNALS:
+    void bookError(int book, const QString &msg);
+    void bookProgress(int book, int done, int total);
+    void bookFinished(int book, qint64 msecs);
+    void progress(int done, int total, double pagesPerSecond);
+    void finished(int pages, qint64 msecs);
+
+private:
+    struct Task
+    {
+        enum
+        {
+            //load the book and queue its pages
+            Load = -1
+        };
+        int book = -1;
+        int page = Load;
+    };
+
+    struct Worker
+    {
+        QMutex mutex;
+        std::deque<Task> tasks;
+        QThread *thread = nullptr;
+    };
+
+    void push(int worker, const QList<Task> &tasks);
+    bool pop(int worker, Task &task);
+    bool steal(int thief, Task &task);
+
+    void runWorker(int worker);
+    //on m_downloadThread, every book is pushed to a worker for loading when its media are done
+    void startDownloads();
+    void loadBook(int worker, const Task &task);
+    void renderPage(BookRenderer &renderer, int &curBook, const Task &task);
+
+private:
+    int m_threadCount = 0;
+    bool m_download = false;
+
+    QList<BatchBook> m_books;
+    //written once by the loading task, before the pages are queued
+    std::vector<BookData> m_bookData;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    //network replies need an event loop, downloads run on this thread instead of a worker
+    QThread *m_downloadThread = nullptr;
+    //lives on m_downloadThread, deleted once it's finished
+    MediaPipeline *m_pipeline = nullptr;
+
+    std::unique_ptr<std::atomic<int>[]> m_bookDone;
+    std::unique_ptr<std::atomic<int>[]> m_bookTotal;
+    std::unique_ptr<QElapsedTimer[]> m_bookTimer;
+
+    QAtomicInt m_pending;
+    QAtomicInt m_done;
+    QAtomicInt m_total;
+    QAtomicInt m_running;
+    QAtomicInt m_cancel;
+
+    QMutex m_idleMutex;
+    QWaitCondition m_wake;
+
+    QElapsedTimer m_timer;
+};
+
+#endif // BATCHSCHEDULER_H
@@ -0,0 +1,171 @@
+#include "BookJson.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QCborValue>
+#include <QCborMap>
+#include <QAtomicInt>
+
+const static quint32 CACHE_MAGIC    = 0x59514243; //"YQBC"
+//bump when the cached nodes or the header change
+const static quint32 CACHE_VERSION  = 1;
+
+//nodes of 'data' read by BookRenderer::load and MediaPipeline::download
+const static char *const CACHED_NODES[] = { "Property", "Profile", "Pages" };
+
+static QAtomicInt s_cacheEnabled = 1;
+
+//identifies the json the cache was built from, without reading the json itself
+static QByteArray sourceKey(const QFileInfo &info)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    return hash.result();
+}
+
+QJsonObject BookJson::loadData(const QString &file, QString *error)
+{
+    if (s_cacheEnabled.loadRelaxed()) {
+        if (auto data = loadCache(file); !data.isEmpty()) {
+            return data;
+        }
+    }
+    const auto data = parseData(file, error);
+    if (!data.isEmpty() && s_cacheEnabled.loadRelaxed()) {
+        saveCache(file, data);
+    }
+    return data;
+}
+
+QString BookJson::cachePathFor(const QString &file)
+{
+    return file + ".bookcache";
+}
+
+void BookJson::setCacheEnabled(bool enabled)
+{
+    s_cacheEnabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+QJsonObject BookJson::parseData(const QString &file, QString *error)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("Can't open as readonly for [%1]!").arg(file);
+        }
+        return QJsonObject();
+    }
+
+    QJsonParseError parseError;
+    QJsonObject data;
+    {
+        //the parser copies what it keeps, the mapping is only read while parsing
+        const qint64 size = f.size();
+        uchar *mapped = size > 0 ? f.map(0, size) : nullptr;
+        QJsonDocument doc;
+        if (mapped) {
+            doc = QJsonDocument::fromJson(QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size),
+                                          &parseError);
+            f.unmap(mapped);
+        } else {
+            //e.g. resource or special file
+            doc = QJsonDocument::fromJson(f.readAll(), &parseError);
+        }
+        if (parseError.error != QJsonParseError::NoError) {
+            if (error) {
+                *error = QString("parse json error at offset [%1]!").arg(QString::number(parseError.offset));
+            }
+            return QJsonObject();
+        }
+        //sub containers are shared separately, dropping doc frees everything outside 'data'
+        data = doc.object().value("data").toObject();
+    }
+
+    if (data.isEmpty() && error) {
+        *error = QString("Parse 'data' node error!");
+    }
+    return data;
+}
+
+QJsonObject BookJson::loadCache(const QString &file)
+{
+    const QFileInfo info(file);
+    QFile f(cachePathFor(file));
+    if (!info.exists() || !f.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    const qint64 size = f.size();
+    uchar *mapped = size > 0 ? f.map(0, size) : nullptr;
+    if (!mapped) {
+        return QJsonObject();
+    }
+
+    QJsonObject data;
+    {
+        const auto bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size);
+        QDataStream in(bytes);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint32 magic = 0;
+        quint32 version = 0;
+        QByteArray key;
+        quint32 payloadSize = 0;
+        in >> magic >> version >> key >> payloadSize;
+        const qint64 offset = in.device()->pos();
+        if (in.status() != QDataStream::Ok
+            || magic != CACHE_MAGIC
+            || version != CACHE_VERSION
+            || key != sourceKey(info)
+            || offset + payloadSize > size) {
+            qDebug()<<Q_FUNC_INFO<<"stale or invalid book cache for "<<file;
+        } else {
+            QCborParserError cborError;
+            const auto payload = QByteArray::fromRawData(bytes.constData() + offset, payloadSize);
+            const auto cbor = QCborValue::fromCbor(payload, &cborError);
+            if (cborError.error != QCborError::NoError || !cbor.isMap()) {
+                qDebug()<<Q_FUNC_INFO<<"broken book cache for "<<file<<cborError.errorString();
+            } else {
+                data = cbor.toMap().toJsonObject();
+            }
+        }
+    }
+    f.unmap(mapped);
+    return data;
+}
+
+bool BookJson::saveCache(const QString &file, const QJsonObject &data)
+{
+    QCborMap nodes;
+    for (const char *node : CACHED_NODES) {
+        const QString key = QLatin1StringView(node);
+        if (data.contains(key)) {
+            nodes.insert(key, QCborValue::fromJsonValue(data.value(key)));
+        }
+    }
+    const QByteArray payload = nodes.toCborValue().toCbor();
+
+    //a reader never sees a half written cache
+    QSaveFile f(cachePathFor(file));
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"can't write book cache "<<f.fileName();
+        return false;
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << CACHE_MAGIC << CACHE_VERSION << sourceKey(QFileInfo(file)) << static_cast<quint32>(payload.size());
+    out.writeRawData(payload.constData(), payload.size());
+    if (out.status() != QDataStream::Ok || !f.commit()) {
+        qDebug()<<Q_FUNC_INFO<<"write book cache error "<<f.fileName();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef BOOKJSON_H
+#define BOOKJSON_H
+
+#include <QJsonObject>
+#include <QString>
+
+/*
+ * Loads the 'data' node of a book json.
+ * The file is mapped instead of read into a QByteArray, and only the 'data' subtree
+ * survives the call, so neither the raw bytes nor the whole document stay in memory.
+ *
+ * The nodes used by the renderer and downloader are kept as CBOR in <json>.bookcache,
+ * so a book seen before is loaded from the binary cache without parsing any text.
+ */
+class BookJson
+{
+public:
+    //empty object and error set if the file can't be read or parsed
+    static QJsonObject loadData(const QString &file, QString *error = nullptr);
+
+    static QString cachePathFor(const QString &file);
+
+    static void setCacheEnabled(bool enabled);
+
+private:
+    static QJsonObject parseData(const QString &file, QString *error);
+
+    static QJsonObject loadCache(const QString &file);
+    static bool saveCache(const QString &file, const QJsonObject &data);
+};
+
+#endif // BOOKJSON_H
@@ -0,0 +1,192 @@
+#ifndef BOOKRENDERER_H
+#define BOOKRENDERER_H
+
+#include <QImage>
+#include <QJsonArray>
+#include <QColor>
+
+#include <functional>
+#include <vector>
+
+#include "PropertyData.h"
+#include "PixelFormatPolicy.h"
+#include "MemoryBudget.h"
+#include "ContentIndex.h"
+#include "MediaLayout.h"
+#include "MediaPack.h"
+#include "MediaProbe.h"
+
+class QPainter;
+
+//parsed book, implicitly shared json so it can be handed to renderers on other threads
+struct BookData
+{
+    QString mediaPath;
+    QString profileAvatar;
+    PageSize pageSize;
+    QJsonArray pages;
+    DividingLine dvLine;
+    Pagination pagination;
+    ContentIndex contents;
+    MediaLayout layout;
+    MediaPack pack;
+    MediaProbeIndex probes;
+};
+
+/*
+ * Renders book pages into an offscreen scene image, not bound to any widget,
+ * so one renderer per thread can be used.
+ */
+class BookRenderer
+{
+public:
+    enum class MediaUsage
+    {
+        Drawn,
+        //only hashed into a QR code text, the file itself is never decoded
+        QrOnly
+    };
+
+    BookRenderer();
+    virtual ~BookRenderer();
+
+    //how media referenced by a json key (e.g. "URL", "VideoUri") is used by the draw routines
+    static MediaUsage mediaUsage(const QString &jsonKey);
+
+    bool load(const QString &jsonPath, const QString &mediaPath);
+
+    BookData book() const;
+
+    void setBook(const BookData &book);
+
+    void render(int pgNum);
+
+    const QImage *image() const;
+
+    int pageCount() const;
+
+    bool save(int pgNum, const QString &path);
+
+    //page drawn through a scaled painter, independent of the scene image, media decoded at the reduced size
+    QImage renderThumbnail(int pgNum, qreal scale);
+
+    //quick first look at scale: no antialiasing, fast scaling, media decoded at the reduced size
+    QImage renderDraft(int pgNum, qreal scale);
+
+    //render all pages as one vector pdf document, text is kept as glyphs
+    bool exportPdf(const QString &file);
+
+    QImage generateBarcode(const QString &text, int width, int height,
+                           QColor foreground = Qt::black,
+                           QColor background = Qt::white);
+
+    QString generateBarcodeText(const QString &uri) const;
+
+protected:
+    virtual bool parseProperty(const QJsonObject &obj);
+    virtual void renderToImage(int pgNum);
+
+private:
+    void drawIntroPage(const QJsonObject &node);
+    void drawVersionPage(const QJsonObject &node);
+    void drawDirectoryPage(const QJsonObject &node);
+    void drawProfilePage(const QJsonObject &node);
+    void drawGraduationPhotoPage(const QJsonObject &node);
+    void drawGraduationMoviePaget(const QJsonObject &node);
+    void drawGraduationDreamPage(const QJsonObject &node);
+    void drawHybridSubject(const QJsonObject &node, const QJsonObject &property);
+    void drawFeedPage(const QJsonObject &node, const QJsonObject &property);
+    void drawPhysicalExaminationPage(const QJsonObject &node, const QJsonObject &property);
+    void drawEWishPage(const QJsonObject &node, const QJsonObject &property);
+    void drawGraduationAudios(const QJsonObject &node, const QJsonObject &property);
+    void drawEFinalPage(const QJsonObject &node, const QJsonObject &property);
+
+
+    void drawPagination(const QJsonObject &node);
+
+    void drawBackground(const QJsonObject &PropertyObject);
+    void drawElement(const QJsonObject &node);
+    void drawTemplateElement(const QJsonObject &node);
+
+private:
+    QString dotExtension(const QString &uri) const;
+
+    //downloaded file of uri for the current page, see MediaLayout
+    QString mediaFile(const QString &uri) const;
+
+    //downloaded file or packed media exists
+    bool hasMedia(const QString &file) const;
+
+    /*
+     * decode downloaded media in the render pixel format. fit maps the full size of the media to
+     * the page pixels it's drawn at, returned in drawSize. Reduced renders decode it at about
+     * their output pixels, draw it with scaledMedia() into a rect of drawSize
+     */
+    bool loadMedia(QImage &img, const QString &file,
+                   const std::function<QSize(const QSize &)> &fit, QSize *drawSize);
+
+    //size page pixels cover in the output, smaller in reduced renders
+    QSize outputPixels(const QSize &size) const;
+
+    //img scaled for drawing into a rect of size page pixels, at the output pixels of reduced renders
+    QImage scaledMedia(const QImage &img, const QSize &size) const;
+
+    //FrameCompositor::roundedFrame of scaledMedia(), radius and border are page pixels
+    QImage framedMedia(const QImage &img, int radius, int border, const QColor &color) const;
+
+    //transparent offscreen part of the page, painters on it use page pixels in reduced renders too
+    QImage mediaCanvas(const QSize &size) const;
+
+    void ensureScene();
+
+    //run the draw routines on another painter, e.g. pdf or thumbnail, targetBytes is the memory of its device
+    bool renderOnto(QPainter *painter, int pgNum, qint64 targetBytes = 0, bool optional = false);
+
+    //page at scale with fast scaling and media decoded at the reduced size, see m_draftScale.
+    //A draft has no antialiasing and is skipped if it doesn't fit the memory budget on the GUI thread
+    QImage renderReduced(int pgNum, qreal scale, bool draft);
+
+    //estimated decoded bytes of the media drawn on page pgNum
+    qint64 pageMediaBytes(int pgNum) const;
+
+    /*
+     * renderToImage under one reservation of targetBytes and the page's media, see MemoryBudget.
+     * The GUI thread never waits for memory, optional renders are skipped there and others go
+     * over budget. False if the page was skipped
+     */
+    bool renderPage(int pgNum, qint64 targetBytes, bool optional = false);
+
+private:
+    Q_DISABLE_COPY(BookRenderer)
+
+    QImage *m_sceneImg = nullptr;
+    QPainter *m_scenePainter = nullptr;
+    PixelFormatPolicy m_pixelFormat;
+    //scale of the draft being rendered, 0 for full quality
+    qreal m_draftScale = 0;
+
+    int m_curID = -1;
+    QString m_mediaPath;
+    QString m_profileAvatar;
+
+    PageSize m_pageSize;
+
+    QJsonArray m_pages;
+    DividingLine m_dvLine;
+    Pagination m_pagination;
+    ContentIndex m_contents;
+    MediaLayout m_layout;
+    //media.pack of the media path, if there is one
+    MediaPack m_pack;
+    //recorded at download time, see MediaProbe
+    MediaProbeIndex m_probes;
+
+    // SubjectFonts m_subjectFonts;
+
+
+
+};
+
+
+
+#endif // BOOKRENDERER_H
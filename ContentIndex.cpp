@@ -0,0 +1,159 @@
+#include "ContentIndex.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCryptographicHash>
+
+#include <filesystem>
+#include <system_error>
+
+ContentIndex::ContentIndex(const QString &mediaPath)
+    : m_mediaPath(QDir(mediaPath).absolutePath())
+{
+
+}
+
+QByteArray ContentIndex::hashOf(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+}
+
+QString ContentIndex::indexPathFor(const QString &mediaPath)
+{
+    return QDir(mediaPath).filePath("content.index");
+}
+
+bool ContentIndex::load()
+{
+    m_identity.clear();
+    m_canonical.clear();
+    QFile f(indexPathFor(m_mediaPath));
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    //one "<hash> <relative path>" per line
+    while (!f.atEnd()) {
+        const QByteArray line = f.readLine().trimmed();
+        const int sep = line.indexOf(' ');
+        if (sep <= 0) {
+            continue;
+        }
+        const QByteArray hash = line.left(sep);
+        const QString file = QString::fromUtf8(line.mid(sep + 1));
+        m_identity.insert(file, hash);
+        if (!m_canonical.contains(hash)) {
+            m_canonical.insert(hash, file);
+        }
+    }
+    return true;
+}
+
+bool ContentIndex::save() const
+{
+    QSaveFile f(indexPathFor(m_mediaPath));
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"can't write "<<f.fileName();
+        return false;
+    }
+    //canonical files first, so load() picks the same ones again
+    for (auto it = m_canonical.constBegin(); it != m_canonical.constEnd(); ++it) {
+        f.write(it.key() + ' ' + it.value().toUtf8() + '\n');
+    }
+    for (auto it = m_identity.constBegin(); it != m_identity.constEnd(); ++it) {
+        if (m_canonical.value(it.value()) != it.key()) {
+            f.write(it.value() + ' ' + it.key().toUtf8() + '\n');
+        }
+    }
+    return f.commit();
+}
+
+bool ContentIndex::isEmpty() const
+{
+    return m_identity.isEmpty();
+}
+
+QByteArray ContentIndex::identity(const QString &file) const
+{
+    return m_identity.value(relative(file));
+}
+
+QString ContentIndex::canonical(const QByteArray &hash) const
+{
+    const auto file = m_canonical.value(hash);
+    return file.isEmpty() ? QString() : QDir(m_mediaPath).filePath(file);
+}
+
+void ContentIndex::insert(const QString &file, const QByteArray &hash)
+{
+    const auto rel = relative(file);
+    //new bytes in an existing file, it can't stay canonical for its old ones
+    if (const auto old = m_identity.value(rel); !old.isEmpty() && old != hash) {
+        remove(file);
+    }
+    m_identity.insert(rel, hash);
+    if (!m_canonical.contains(hash)) {
+        m_canonical.insert(hash, rel);
+    }
+}
+
+void ContentIndex::remove(const QString &file)
+{
+    const auto rel = relative(file);
+    const QByteArray hash = m_identity.take(rel);
+    if (hash.isEmpty() || m_canonical.value(hash) != rel) {
+        return;
+    }
+    m_canonical.remove(hash);
+    for (auto it = m_identity.constBegin(); it != m_identity.constEnd(); ++it) {
+        if (it.value() == hash) {
+            m_canonical.insert(hash, it.key());
+            break;
+        }
+    }
+}
+
+bool ContentIndex::store(const QString &file, const QByteArray &data)
+{
+    const QByteArray hash = hashOf(data);
+    const QString canon = canonical(hash);
+    if (!canon.isEmpty() && QFileInfo(canon) != QFileInfo(file) && QFile::exists(canon)) {
+        QFile::remove(file);
+        std::error_code ec;
+        std::filesystem::create_hard_link(std::filesystem::path(canon.toStdU16String()),
+                                          std::filesystem::path(file.toStdU16String()),
+                                          ec);
+        if (!ec) {
+            insert(file, hash);
+            return true;
+        }
+        //e.g. another file system, keep a copy
+        qDebug()<<Q_FUNC_INFO<<"hard link "<<file<<" to "<<canon<<" error "<<ec.message().c_str();
+    }
+
+    //file may be a hard link from an earlier download, never write through it
+    QFile::remove(file);
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"open error "<<file;
+        return false;
+    }
+    if (f.write(data) != data.size()) {
+        qDebug()<<Q_FUNC_INFO<<"write error "<<file;
+        return false;
+    }
+    f.close();
+    if (!canon.isEmpty() && !QFile::exists(canon)) {
+        //canonical file was removed, this one takes its place
+        m_canonical.remove(hash);
+    }
+    insert(file, hash);
+    return true;
+}
+
+QString ContentIndex::relative(const QString &file) const
+{
+    return QDir(m_mediaPath).relativeFilePath(QFileInfo(file).absoluteFilePath());
+}
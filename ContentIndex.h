@@ -0,0 +1,55 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+/*
+ * Content hashes of the downloaded media of one media path, kept in <media path>/content.index.
+ * The downloader links files with the same bytes to one canonical file, the renderer uses
+ * the hash as identity of a file, so the same photo behind several uris is decoded once.
+ */
+class ContentIndex
+{
+public:
+    ContentIndex() = default;
+    explicit ContentIndex(const QString &mediaPath);
+
+    static QByteArray hashOf(const QByteArray &data);
+
+    static QString indexPathFor(const QString &mediaPath);
+
+    bool load();
+    bool save() const;
+
+    bool isEmpty() const;
+
+    //content hash of file, empty if it's not indexed
+    QByteArray identity(const QString &file) const;
+
+    //first file stored with hash, empty if none
+    QString canonical(const QByteArray &hash) const;
+
+    void insert(const QString &file, const QByteArray &hash);
+
+    //forget file, another file with the same hash becomes canonical
+    void remove(const QString &file);
+
+    /*
+     * store data as file, as a hard link to the canonical file if the same bytes are already stored,
+     * returns false if the file can't be written
+     */
+    bool store(const QString &file, const QByteArray &data);
+
+private:
+    QString relative(const QString &file) const;
+
+private:
+    QString m_mediaPath;
+    //path relative to m_mediaPath to content hash
+    QHash<QString, QByteArray> m_identity;
+    QHash<QByteArray, QString> m_canonical;
+};
+
+#endif // CONTENTINDEX_H
@@ -0,0 +1,359 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <QObject>
+#include <QNetworkReply>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/*
+ * C++20 coroutines on the Qt event loop. A coroutine runs on the thread of the QObject given
+ * to its awaitables (the GUI thread for the pipeline), every co_await suspends without blocking:
+ * finished(reply) resumes on QNetworkReply::finished, runOn() runs a function on a thread pool
+ * and resumes with its result through the event loop.
+ * Coroutines take their arguments by value, references would dangle across a suspension.
+ */
+namespace Coro {
+
+template<typename T>
+class Task;
+
+namespace detail {
+
+struct PromiseBase
+{
+    //coroutine awaiting this one, resumed when it's done
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            if (auto c = h.promise().continuation) {
+                return c;
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    //lazy, started when awaited
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    //the project doesn't use exceptions
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template<typename T>
+struct Promise : PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+};
+
+template<>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+
+    void return_void() {}
+};
+
+} //namespace detail
+
+//result of a coroutine, started by co_await or Coro::start()
+template<typename T = void>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle h) : m_handle(h) {}
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ~Task()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+    Q_DISABLE_COPY(Task)
+
+    bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    T await_resume()
+    {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*m_handle.promise().value);
+        }
+    }
+
+private:
+    Handle m_handle;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+//runs to the end on its own, owns the task it awaits
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} //namespace detail
+
+//start task without awaiting it, done is called with its result
+template<typename T, typename F>
+detail::Detached start(Task<T> task, F done)
+{
+    if constexpr (std::is_void_v<T>) {
+        co_await task;
+        done();
+    } else {
+        done(co_await task);
+    }
+}
+
+template<typename T>
+detail::Detached start(Task<T> task)
+{
+    co_await task;
+}
+
+//resumes when reply is finished, aborting the reply resumes it too
+inline auto finished(QNetworkReply *reply)
+{
+    struct Awaiter
+    {
+        QNetworkReply *reply;
+
+        bool await_ready() const { return reply->isFinished(); }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            QObject::connect(reply, &QNetworkReply::finished,
+                             reply, [h]() { h.resume(); },
+                             Qt::SingleShotConnection);
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter { reply };
+}
+
+//resumes after msecs on the thread of context, not at all if context is gone by then
+inline auto sleep(QObject *context, int msecs)
+{
+    struct Awaiter
+    {
+        QObject *context;
+        int msecs;
+
+        bool await_ready() const noexcept { return msecs <= 0; }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            QTimer::singleShot(msecs, context, [h]() { h.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter { context, msecs };
+}
+
+/*
+ * run fn on pool, resume on the thread of context with its result. The coroutine is not
+ * resumed if context is gone by then, keep context alive until the coroutine is done
+ */
+template<typename F>
+auto runOn(QThreadPool *pool, QObject *context, F fn)
+{
+    using R = std::invoke_result_t<F>;
+    struct Awaiter
+    {
+        QThreadPool *pool;
+        QObject *context;
+        F fn;
+        std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> result {};
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            pool->start([this, h]() {
+                if constexpr (std::is_void_v<R>) {
+                    fn();
+                } else {
+                    result.emplace(fn());
+                }
+                QMetaObject::invokeMethod(context, [h]() { h.resume(); }, Qt::QueuedConnection);
+            });
+        }
+
+        R await_resume()
+        {
+            if constexpr (!std::is_void_v<R>) {
+                return std::move(*result);
+            }
+        }
+    };
+    return Awaiter { pool, context, std::move(fn) };
+}
+
+/*
+ * bounds how many coroutines run a section at once. Only used on the thread of context,
+ * waiters are resumed through its event loop so a release never runs the next one inline
+ */
+class Semaphore
+{
+public:
+    Semaphore(int count, QObject *context) : m_count(count), m_context(context) {}
+    Q_DISABLE_COPY(Semaphore)
+
+    //released when destroyed
+    class Permit
+    {
+    public:
+        explicit Permit(Semaphore *sem) : m_sem(sem) {}
+        Permit(Permit &&other) noexcept : m_sem(std::exchange(other.m_sem, nullptr)) {}
+        ~Permit()
+        {
+            if (m_sem) {
+                m_sem->release();
+            }
+        }
+        Q_DISABLE_COPY(Permit)
+
+    private:
+        Semaphore *m_sem;
+    };
+
+    auto acquire()
+    {
+        struct Awaiter
+        {
+            Semaphore *sem;
+
+            bool await_ready() const noexcept
+            {
+                if (sem->m_count > 0) {
+                    sem->m_count--;
+                    return true;
+                }
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) { sem->m_waiters.push_back(h); }
+
+            //a resumed waiter got the count of its releaser
+            Permit await_resume() const noexcept { return Permit(sem); }
+        };
+        return Awaiter { this };
+    }
+
+private:
+    void release()
+    {
+        if (m_waiters.empty()) {
+            m_count++;
+            return;
+        }
+        const auto h = m_waiters.front();
+        m_waiters.pop_front();
+        QMetaObject::invokeMethod(m_context, [h]() { h.resume(); }, Qt::QueuedConnection);
+    }
+
+private:
+    int m_count;
+    QObject *m_context;
+    std::deque<std::coroutine_handle<>> m_waiters;
+};
+
+//started children are awaited together, nothing outlives the scope that waits
+class TaskGroup
+{
+public:
+    TaskGroup() = default;
+    Q_DISABLE_COPY(TaskGroup)
+
+    void spawn(Task<void> task)
+    {
+        m_running++;
+        start(std::move(task), [this]() {
+            if (--m_running == 0 && m_waiter) {
+                std::exchange(m_waiter, {}).resume();
+            }
+        });
+    }
+
+    auto wait()
+    {
+        struct Awaiter
+        {
+            TaskGroup *group;
+
+            bool await_ready() const noexcept { return group->m_running == 0; }
+            void await_suspend(std::coroutine_handle<> h) noexcept { group->m_waiter = h; }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter { this };
+    }
+
+private:
+    int m_running = 0;
+    std::coroutine_handle<> m_waiter;
+};
+
+} //namespace Coro
+
+#endif // COROUTINE_H
@@ -0,0 +1,62 @@
+#include "DecorationPack.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "PixelFormatPolicy.h"
+
+DecorationPack::DecorationPack()
+{
+
+}
+
+DecorationPack *DecorationPack::instance()
+{
+    static DecorationPack s_pack;
+    return &s_pack;
+}
+
+QImage DecorationPack::image(const QString &resource)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto it = m_images.constFind(resource); it != m_images.constEnd()) {
+            return it.value();
+        }
+    }
+    QImage img;
+    if (!PixelFormatPolicy().load(img, resource)) {
+        qWarning()<<Q_FUNC_INFO<<"load decoration error "<<resource;
+    }
+    //failed ones are kept too, so they are not decoded again on every page
+    QMutexLocker locker(&m_mutex);
+    m_images.insert(resource, img);
+    return img;
+}
+
+QImage DecorationPack::image(const QString &resource, const QSize &size, Qt::AspectRatioMode mode)
+{
+    const QString key = QString("%1|%2x%3|%4")
+                            .arg(resource)
+                            .arg(size.width())
+                            .arg(size.height())
+                            .arg(static_cast<int>(mode));
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto it = m_images.constFind(key); it != m_images.constEnd()) {
+            return it.value();
+        }
+    }
+    const QImage src = image(resource);
+    const QImage img = src.isNull() ? QImage() : src.scaled(size, mode);
+
+    QMutexLocker locker(&m_mutex);
+    m_images.insert(key, img);
+    return img;
+}
+
+void DecorationPack::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_images.clear();
+}
@@ -0,0 +1,36 @@
+#ifndef DECORATIONPACK_H
+#define DECORATIONPACK_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/*
+ * Built-in decorations (VV layouts, QR frames, stars) decoded once on first use
+ * in the render pixel format, plus the scaled copies the layouts ask for.
+ * Thread safe, returned images are implicitly shared with the pack.
+ */
+class DecorationPack
+{
+public:
+    static DecorationPack *instance();
+
+    //resource path, e.g. ":/star-full.webp", null image if it can't be decoded
+    QImage image(const QString &resource);
+
+    //same as image(resource).scaled(size, mode), without smoothing like the layouts always did
+    QImage image(const QString &resource, const QSize &size, Qt::AspectRatioMode mode = Qt::KeepAspectRatio);
+
+    void clear();
+
+private:
+    DecorationPack();
+    Q_DISABLE_COPY(DecorationPack)
+
+private:
+    QMutex m_mutex;
+    QHash<QString, QImage> m_images;
+};
+
+#endif // DECORATIONPACK_H
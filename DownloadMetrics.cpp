@@ -0,0 +1,261 @@
+#include "DownloadMetrics.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <algorithm>
+#include <cmath>
+
+//TODO magic buckets, media are some KB to tens of MB from a CDN
+const static QList<double> LATENCY_BUCKETS_MS = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+const static QList<double> SIZE_BUCKETS = { 16e3, 64e3, 256e3, 1e6, 4e6, 16e6, 64e6 };
+
+const static int SLOWEST_CNT = 10;
+
+//prometheus text value, integers without exponent, others without losing digits
+static QString promNumber(double value)
+{
+    if (value == std::floor(value) && std::abs(value) < 9007199254740992.0) {
+        return QString::number(value, 'f', 0);
+    }
+    return QString::number(value, 'g', 17);
+}
+
+static Histogram makeHistogram(const QList<double> &bounds)
+{
+    Histogram h;
+    h.bounds = bounds;
+    h.counts.fill(0, bounds.size() + 1);
+    return h;
+}
+
+void Histogram::observe(double value)
+{
+    for (int i=0; i<counts.size(); ++i) {
+        if (i == bounds.size() || value <= bounds.at(i)) {
+            counts[i]++;
+        }
+    }
+    sum += value;
+    count++;
+}
+
+QJsonObject Histogram::toJson() const
+{
+    QJsonArray buckets;
+    for (int i=0; i<counts.size(); ++i) {
+        QJsonObject b;
+        b.insert("le", i < bounds.size() ? QJsonValue(bounds.at(i)) : QJsonValue(QString("+Inf")));
+        b.insert("count", static_cast<qint64>(counts.at(i)));
+        buckets.append(b);
+    }
+    QJsonObject obj;
+    obj.insert("buckets", buckets);
+    obj.insert("sum", sum);
+    obj.insert("count", static_cast<qint64>(count));
+    obj.insert("mean", count > 0 ? sum / count : 0.0);
+    return obj;
+}
+
+QJsonObject DownloadStats::toJson() const
+{
+    QJsonObject errs;
+    for (auto it = errors.constBegin(); it != errors.constEnd(); ++it) {
+        errs.insert(it.key(), it.value());
+    }
+    QJsonArray slow;
+    for (const auto &it : slowest) {
+        slow.append(QJsonObject { {"url", it.first}, {"ms", it.second} });
+    }
+    QJsonObject obj;
+    obj.insert("elapsed_ms", elapsedMs);
+    obj.insert("bytes", bytes);
+    obj.insert("bytes_per_second", bytesPerSecond);
+    obj.insert("in_flight", inFlight);
+    obj.insert("max_in_flight", maxInFlight);
+    obj.insert("requests", requests);
+    obj.insert("succeeded", succeeded);
+    obj.insert("failed", failed);
+    obj.insert("retries", retries);
+    obj.insert("errors", errs);
+    obj.insert("slowest", slow);
+    obj.insert("latency_ms", latencyMs.toJson());
+    obj.insert("ttfb_ms", ttfbMs.toJson());
+    obj.insert("size_bytes", sizeBytes.toJson());
+    return obj;
+}
+
+static void appendHistogram(QString &out, const QString &name, const QString &help, const Histogram &h)
+{
+    out += QString("# HELP %1 %2\n# TYPE %1 histogram\n").arg(name, help);
+    for (int i=0; i<h.counts.size(); ++i) {
+        const QString le = i < h.bounds.size() ? promNumber(h.bounds.at(i)) : QString("+Inf");
+        out += QString("%1_bucket{le=\"%2\"} %3\n").arg(name, le).arg(h.counts.at(i));
+    }
+    out += QString("%1_sum %2\n%1_count %3\n").arg(name, promNumber(h.sum)).arg(h.count);
+}
+
+static void appendValue(QString &out, const QString &name, const QString &type, const QString &help, double value)
+{
+    out += QString("# HELP %1 %2\n# TYPE %1 %3\n%1 %4\n").arg(name, help, type, promNumber(value));
+}
+
+QString DownloadStats::toPrometheus() const
+{
+    QString out;
+    appendValue(out, "yqzd_download_bytes_total", "counter", "Bytes of finished downloads.", bytes);
+    appendValue(out, "yqzd_download_bytes_per_second", "gauge", "Average throughput since the first request.", bytesPerSecond);
+    appendValue(out, "yqzd_download_in_flight", "gauge", "Requests in flight.", inFlight);
+    appendValue(out, "yqzd_download_max_in_flight", "gauge", "Most requests in flight at once.", maxInFlight);
+    appendValue(out, "yqzd_download_requests_total", "counter", "Finished requests, retries included.", requests);
+    appendValue(out, "yqzd_download_failed_total", "counter", "Failed requests.", failed);
+    appendValue(out, "yqzd_download_retries_total", "counter", "Requests of an uri after its first attempt.", retries);
+
+    out += QString("# HELP yqzd_download_errors_total Failed requests by class.\n"
+                   "# TYPE yqzd_download_errors_total counter\n");
+    for (auto it = errors.constBegin(); it != errors.constEnd(); ++it) {
+        out += QString("yqzd_download_errors_total{class=\"%1\"} %2\n").arg(it.key()).arg(it.value());
+    }
+
+    appendHistogram(out, "yqzd_download_latency_ms", "Request latency until finished.", latencyMs);
+    appendHistogram(out, "yqzd_download_ttfb_ms", "Time to first byte.", ttfbMs);
+    appendHistogram(out, "yqzd_download_size_bytes", "Size of downloaded media.", sizeBytes);
+    return out;
+}
+
+DownloadMetrics::DownloadMetrics()
+{
+    reset();
+}
+
+void DownloadMetrics::reset()
+{
+    m_timer.invalidate();
+    m_pending.clear();
+    m_attempts.clear();
+    m_stats = DownloadStats();
+    m_stats.latencyMs = makeHistogram(LATENCY_BUCKETS_MS);
+    m_stats.ttfbMs    = makeHistogram(LATENCY_BUCKETS_MS);
+    m_stats.sizeBytes = makeHistogram(SIZE_BUCKETS);
+}
+
+void DownloadMetrics::requestStarted(const QNetworkReply *reply, const QString &uri)
+{
+    if (!m_timer.isValid()) {
+        m_timer.start();
+    }
+    Pending p;
+    p.uri = uri;
+    p.timer.start();
+    m_pending.insert(reply, p);
+    if (++m_attempts[uri] > 1) {
+        m_stats.retries++;
+    }
+    m_stats.maxInFlight = qMax<int>(m_stats.maxInFlight, m_pending.size());
+}
+
+void DownloadMetrics::firstByte(const QNetworkReply *reply)
+{
+    if (auto it = m_pending.find(reply); it != m_pending.end() && it->ttfbMs < 0) {
+        it->ttfbMs = it->timer.elapsed();
+    }
+}
+
+void DownloadMetrics::requestFinished(const QNetworkReply *reply, qint64 bytes, QNetworkReply::NetworkError error, int httpStatus)
+{
+    const auto p = m_pending.take(reply);
+    const qint64 ms = p.timer.isValid() ? p.timer.elapsed() : 0;
+
+    m_stats.requests++;
+    m_stats.latencyMs.observe(ms);
+    if (p.ttfbMs >= 0) {
+        m_stats.ttfbMs.observe(p.ttfbMs);
+    }
+    if (error != QNetworkReply::NoError) {
+        m_stats.failed++;
+        m_stats.errors[errorClass(error, httpStatus)]++;
+        return;
+    }
+    m_stats.succeeded++;
+    m_stats.bytes += bytes;
+    m_stats.sizeBytes.observe(bytes);
+
+    auto &slow = m_stats.slowest;
+    slow.append(qMakePair(p.uri, ms));
+    std::sort(slow.begin(), slow.end(), [](const auto &a, const auto &b) {
+        return a.second > b.second;
+    });
+    if (slow.size() > SLOWEST_CNT) {
+        slow.resize(SLOWEST_CNT);
+    }
+}
+
+int DownloadMetrics::inFlight() const
+{
+    return m_pending.size();
+}
+
+DownloadStats DownloadMetrics::stats() const
+{
+    DownloadStats s = m_stats;
+    s.elapsedMs = m_timer.isValid() ? m_timer.elapsed() : 0;
+    s.inFlight = m_pending.size();
+    s.bytesPerSecond = s.bytes * 1000.0 / qMax<qint64>(1, s.elapsedMs);
+    return s;
+}
+
+bool DownloadMetrics::write(const QString &path, const QString &baseName) const
+{
+    const auto s = stats();
+    const QDir dir(path);
+    bool ok = true;
+    {
+        QSaveFile f(dir.filePath(baseName + ".prom"));
+        ok = f.open(QIODevice::WriteOnly) && f.write(s.toPrometheus().toUtf8()) >= 0 && f.commit() && ok;
+    }
+    {
+        QSaveFile f(dir.filePath(baseName + ".json"));
+        ok = f.open(QIODevice::WriteOnly) && f.write(QJsonDocument(s.toJson()).toJson()) >= 0 && f.commit() && ok;
+    }
+    if (!ok) {
+        qDebug()<<Q_FUNC_INFO<<"write download metrics error in "<<path;
+    }
+    return ok;
+}
+
+QString DownloadMetrics::errorClass(QNetworkReply::NetworkError error, int httpStatus)
+{
+    if (httpStatus >= 500) {
+        return "http_5xx";
+    }
+    if (httpStatus >= 400) {
+        return "http_4xx";
+    }
+    switch (error) {
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:
+        return "timeout";
+    case QNetworkReply::HostNotFoundError:
+        return "dns";
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+        return "connection";
+    case QNetworkReply::SslHandshakeFailedError:
+        return "tls";
+    default:
+        break;
+    }
+    if (error >= QNetworkReply::ProxyConnectionRefusedError && error < QNetworkReply::ContentAccessDenied) {
+        return "proxy";
+    }
+    if (error >= QNetworkReply::ContentAccessDenied && error < QNetworkReply::ProtocolUnknownError) {
+        return "content";
+    }
+    return "other";
+}
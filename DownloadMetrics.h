@@ -0,0 +1,92 @@
+#ifndef DOWNLOADMETRICS_H
+#define DOWNLOADMETRICS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+#include <QNetworkReply>
+
+//cumulative histogram with fixed upper bounds, same semantics as a prometheus histogram
+struct Histogram
+{
+    QList<double> bounds;
+    //counts.at(i) observations <= bounds.at(i), last one is +Inf
+    QList<quint64> counts;
+    double sum = 0;
+    quint64 count = 0;
+
+    void observe(double value);
+    QJsonObject toJson() const;
+};
+
+struct DownloadStats
+{
+    qint64 elapsedMs = 0;
+    qint64 bytes = 0;
+    double bytesPerSecond = 0;
+    int inFlight = 0;
+    int maxInFlight = 0;
+    int requests = 0;
+    int succeeded = 0;
+    int failed = 0;
+    int retries = 0;
+    //error class name to count, see DownloadMetrics::errorClass()
+    QHash<QString, int> errors;
+    //slowest requests, to spot slow CDN nodes
+    QList<QPair<QString, qint64>> slowest;
+    Histogram latencyMs;
+    Histogram ttfbMs;
+    Histogram sizeBytes;
+
+    QJsonObject toJson() const;
+    QString toPrometheus() const;
+};
+Q_DECLARE_METATYPE(DownloadStats)
+
+/*
+ * Per request timing, size and error bookkeeping of MediaDownloader, keyed by reply so
+ * concurrent requests of the same uri keep their own timings. Retries are counted per uri.
+ * Used on the downloader's thread only.
+ */
+class DownloadMetrics
+{
+public:
+    DownloadMetrics();
+
+    void reset();
+
+    void requestStarted(const QNetworkReply *reply, const QString &uri);
+    void firstByte(const QNetworkReply *reply);
+    void requestFinished(const QNetworkReply *reply, qint64 bytes, QNetworkReply::NetworkError error, int httpStatus);
+
+    int inFlight() const;
+
+    DownloadStats stats() const;
+
+    //writes <path>/<baseName>.prom and <path>/<baseName>.json
+    bool write(const QString &path, const QString &baseName = QString("download-metrics")) const;
+
+    //coarse class of a failed reply, e.g. "timeout", "http_5xx"
+    static QString errorClass(QNetworkReply::NetworkError error, int httpStatus);
+
+private:
+    struct Pending
+    {
+        QString uri;
+        QElapsedTimer timer;
+        qint64 ttfbMs = -1;
+    };
+
+private:
+    QElapsedTimer m_timer;
+    QHash<const QNetworkReply*, Pending> m_pending;
+    //attempts per uri, more than one is a retry
+    QHash<QString, int> m_attempts;
+    DownloadStats m_stats;
+};
+
+#endif // DOWNLOADMETRICS_H
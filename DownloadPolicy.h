@@ -0,0 +1,27 @@
+#ifndef DOWNLOADPOLICY_H
+#define DOWNLOADPOLICY_H
+
+#include <QtGlobal>
+
+/*
+ * Limits of media downloads of MediaPipeline.
+ * Failed requests and invalid bodies of a uri are counted apart, either gives the uri up
+ * after DL_MAX_TRY tries.
+ */
+
+//TODO magic, parallel downloads
+const static int DL_MAX_CNT = 5;
+
+//TODO magic, tries of a uri before it's given up
+const static int DL_MAX_TRY = 4;
+
+//TODO magic, wait before the first retry, doubled by every further one
+const static int DL_RETRY_BASE_MS = 500;
+
+//wait before the next try of a uri that failed tries times
+inline int dlRetryDelay(int tries)
+{
+    return DL_RETRY_BASE_MS << qBound(0, tries - 1, 4);
+}
+
+#endif // DOWNLOADPOLICY_H
@@ -0,0 +1,79 @@
+#include "FontRegistry.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFontDatabase>
+#include <QResource>
+#include <QElapsedTimer>
+
+#include <mutex>
+
+struct FontEntry
+{
+    const char *file;
+    //used if registration fails, e.g. the font is installed on the system
+    const char *family;
+};
+
+const static FontEntry FONT_ENTRIES[] = {
+    { "yahei.ttf",                  "Microsoft YaHei" },
+    { "yuanti.ttf",                 "HYZhongYuanJ" },
+    { "SourceHanSansCN-Normal.ttf", "Source Han Sans CN Normal" },
+};
+static_assert(sizeof(FONT_ENTRIES) / sizeof(FONT_ENTRIES[0]) == static_cast<int>(FontRegistry::Role::RoleCount),
+              "one font entry per role");
+
+static QString s_fontDir;
+static std::once_flag s_once[static_cast<int>(FontRegistry::Role::RoleCount)];
+static QString s_family[static_cast<int>(FontRegistry::Role::RoleCount)];
+
+QString FontRegistry::family(Role role)
+{
+    const int idx = static_cast<int>(role);
+    std::call_once(s_once[idx], [role, idx]() {
+        s_family[idx] = registerFont(role);
+    });
+    return s_family[idx];
+}
+
+void FontRegistry::registerAll()
+{
+    for (int idx = 0; idx < static_cast<int>(Role::RoleCount); ++idx) {
+        family(static_cast<Role>(idx));
+    }
+}
+
+void FontRegistry::setFontDir(const QString &dir)
+{
+    s_fontDir = dir;
+}
+
+QString FontRegistry::registerFont(Role role)
+{
+    const auto &entry = FONT_ENTRIES[static_cast<int>(role)];
+    QElapsedTimer timer;
+    timer.start();
+
+    int id = -1;
+    if (const QString file = QDir(s_fontDir).filePath(entry.file); !s_fontDir.isEmpty() && QFile::exists(file)) {
+        id = QFontDatabase::addApplicationFont(file);
+    } else {
+        //stored uncompressed, data() points into the binary and the font database shares it
+        const QResource res(QString(":/%1").arg(entry.file));
+        if (res.isValid() && res.compressionAlgorithm() == QResource::NoCompression) {
+            id = QFontDatabase::addApplicationFontFromData(
+                QByteArray::fromRawData(reinterpret_cast<const char *>(res.data()), res.size()));
+        } else {
+            id = QFontDatabase::addApplicationFont(res.absoluteFilePath());
+        }
+    }
+
+    const auto fonts = QFontDatabase::applicationFontFamilies(id);
+    qDebug()<<Q_FUNC_INFO<<"fonts: "<<fonts<<" in "<<timer.elapsed()<<" ms";
+    if (fonts.isEmpty()) {
+        qWarning()<<Q_FUNC_INFO<<"register font error "<<entry.file;
+        return QLatin1StringView(entry.family);
+    }
+    return fonts.first();
+}
@@ -0,0 +1,36 @@
+#ifndef FONTREGISTRY_H
+#define FONTREGISTRY_H
+
+#include <QString>
+
+/*
+ * Application fonts registered on first use by role instead of at startup.
+ * Fonts are read from a directory on disk if one is set, so they are mapped by the font engine,
+ * otherwise from the uncompressed copies in font.qrc without copying them out of the binary.
+ * Thread safe, renderers on any thread can ask for a family.
+ */
+class FontRegistry
+{
+public:
+    enum class Role
+    {
+        YaHei,
+        YuanTi,
+        HanSans,
+        RoleCount
+    };
+
+    //family name of role, the font is registered the first time it's asked for
+    static QString family(Role role);
+
+    //registers the fonts of all roles, text drawn in the default font may still fall back to them
+    static void registerAll();
+
+    //read <dir>/<font file> instead of the resources, must be set before the first family() call
+    static void setFontDir(const QString &dir);
+
+private:
+    static QString registerFont(Role role);
+};
+
+#endif // FONTREGISTRY_H
@@ -0,0 +1,165 @@
+#include "FrameCompositor.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QPainter>
+
+#include <utility>
+
+#include "MemoryBudget.h"
+
+//TODO magic number, masks of all frame sizes in a book are far less
+const static int MASK_CACHE_MAX_CNT = 256;
+
+namespace {
+
+//multiply all channels of a premultiplied pixel by a/255, same as qt's BYTE_MUL
+inline quint32 byteMul(quint32 x, quint32 a)
+{
+    quint32 t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080);
+    x &= 0xff00ff00;
+    return x | t;
+}
+
+//dst = coverage * color, the loop has no branch so the compiler can vectorize it
+void fillMasked(quint32 *dst, const uchar *cov, quint32 color, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        dst[i] = byteMul(color, cov[i]);
+    }
+}
+
+//dst = coverage * src + (1 - alpha(coverage * src)) * dst
+void blendMasked(quint32 *dst, const quint32 *src, const uchar *cov, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        const quint32 s = byteMul(src[i], cov[i]);
+        dst[i] = s + byteMul(dst[i], 255 - qAlpha(s));
+    }
+}
+
+} //namespace
+
+FrameCompositor::FrameCompositor()
+{
+    MemoryBudget::instance()->addReclaimer([this]() {
+        QMutexLocker locker(&m_mutex);
+        const qint64 bytes = std::exchange(m_maskBytes, 0);
+        m_masks.clear();
+        locker.unlock();
+        MemoryBudget::instance()->releaseRetained(bytes);
+        return bytes;
+    });
+}
+
+FrameCompositor *FrameCompositor::instance()
+{
+    static FrameCompositor s_compositor;
+    return &s_compositor;
+}
+
+QImage FrameCompositor::roundedFrame(const QImage &img, int radius, int border, const QColor &borderColor)
+{
+    return compose(img, qMax(radius, 0), qMax(border, 0), borderColor);
+}
+
+QImage FrameCompositor::ellipse(const QImage &img)
+{
+    return compose(img, -1, 0, Qt::transparent);
+}
+
+void FrameCompositor::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 bytes = std::exchange(m_maskBytes, 0);
+    m_masks.clear();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(bytes);
+}
+
+QImage FrameCompositor::mask(const QSize &size, int radius)
+{
+    const QString key = QString("%1x%2|%3").arg(size.width()).arg(size.height()).arg(radius);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto it = m_masks.constFind(key); it != m_masks.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QImage cov(size, QImage::Format_ARGB32_Premultiplied);
+    cov.fill(Qt::GlobalColor::transparent);
+    {
+        QPainter p(&cov);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(Qt::NoPen);
+        p.setBrush(Qt::GlobalColor::white);
+        if (radius < 0) {
+            p.drawEllipse(QRectF(cov.rect()));
+        } else {
+            p.drawRoundedRect(QRectF(cov.rect()), radius, radius);
+        }
+    }
+    cov.convertTo(QImage::Format_Alpha8);
+
+    //not part of any page reservation, used uncached if it doesn't fit
+    const qint64 cost = cov.sizeInBytes();
+    if (!MemoryBudget::instance()->retain(cost)) {
+        return cov;
+    }
+    QMutexLocker locker(&m_mutex);
+    const qint64 before = m_maskBytes;
+    if (m_masks.size() >= MASK_CACHE_MAX_CNT) {
+        m_masks.clear();
+        m_maskBytes = 0;
+    }
+    //another thread may have made the same mask meanwhile
+    m_maskBytes -= m_masks.value(key).sizeInBytes();
+    m_masks.insert(key, cov);
+    m_maskBytes += cost;
+    const qint64 freed = before + cost - m_maskBytes;
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(freed);
+    return cov;
+}
+
+QImage FrameCompositor::compose(const QImage &img, int radius, int border, const QColor &borderColor)
+{
+    if (img.isNull()) {
+        return QImage();
+    }
+    //RGB32 has the same layout as premultiplied ARGB32 with alpha 0xff
+    QImage src = img;
+    if (src.format() != QImage::Format_RGB32 && src.format() != QImage::Format_ARGB32_Premultiplied) {
+        src.convertTo(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    QImage out(src.width() + border *2, src.height() + border *2, QImage::Format_ARGB32_Premultiplied);
+
+    if (border > 0 && borderColor.alpha() > 0) {
+        const QImage outer = mask(out.size(), radius);
+        const quint32 color = qPremultiply(borderColor.rgba());
+        for (int y = 0; y < out.height(); ++y) {
+            fillMasked(reinterpret_cast<quint32 *>(out.scanLine(y)),
+                       outer.constScanLine(y),
+                       color,
+                       out.width());
+        }
+    } else {
+        out.fill(Qt::GlobalColor::transparent);
+    }
+
+    const QImage inner = mask(src.size(), radius);
+    for (int y = 0; y < src.height(); ++y) {
+        blendMasked(reinterpret_cast<quint32 *>(out.scanLine(y + border)) + border,
+                    reinterpret_cast<const quint32 *>(src.constScanLine(y)),
+                    inner.constScanLine(y),
+                    src.width());
+    }
+    return out;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAMECOMPOSITOR_H
+#define FRAMECOMPOSITOR_H
+
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+
+/*
+ * Rounded frames and circular crops for photos and avatars.
+ * Alpha masks are rasterized once per (size, radius) and applied with a per pixel multiply,
+ * so framing a photo needs no clip path nor temporary pixmap.
+ */
+class FrameCompositor
+{
+public:
+    static FrameCompositor *instance();
+
+    //img clipped by a rounded rect of radius, surrounded by border pixels of borderColor
+    QImage roundedFrame(const QImage &img, int radius, int border = 0, const QColor &borderColor = Qt::transparent);
+
+    //img clipped by the ellipse of its rect
+    QImage ellipse(const QImage &img);
+
+    void clear();
+
+private:
+    FrameCompositor();
+    Q_DISABLE_COPY(FrameCompositor)
+
+    //Format_Alpha8 coverage mask, radius < 0 for ellipse
+    QImage mask(const QSize &size, int radius);
+
+    QImage compose(const QImage &img, int radius, int border, const QColor &borderColor);
+
+private:
+    QMutex m_mutex;
+    QHash<QString, QImage> m_masks;
+    //retained in the MemoryBudget
+    qint64 m_maskBytes = 0;
+};
+
+#endif // FRAMECOMPOSITOR_H
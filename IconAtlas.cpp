@@ -0,0 +1,82 @@
+#include "IconAtlas.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPaintEngine>
+#include <QFontMetrics>
+
+//TODO magic number, a book uses a handful of icons at a few sizes
+const static int SPRITE_CACHE_MAX_CNT = 256;
+
+//antialiased edges and color glyphs may reach out of the font's bounding rect
+const static int SPRITE_PADDING = 2;
+
+IconAtlas::IconAtlas()
+{
+
+}
+
+IconAtlas *IconAtlas::instance()
+{
+    static IconAtlas s_atlas;
+    return &s_atlas;
+}
+
+void IconAtlas::drawText(QPainter *painter, const QPointF &baseline, const QString &text)
+{
+    //keep glyphs in vector outputs, e.g. pdf
+    if (!painter->paintEngine() || painter->paintEngine()->type() != QPaintEngine::Raster) {
+        painter->drawText(baseline, text);
+        return;
+    }
+    const auto s = sprite(text, painter->font(), painter->pen().color());
+    if (s.image.isNull()) {
+        painter->drawText(baseline, text);
+        return;
+    }
+    painter->drawImage(QPointF(baseline.x() - s.origin.x(), baseline.y() - s.origin.y()), s.image);
+}
+
+void IconAtlas::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_sprites.clear();
+}
+
+IconAtlas::Sprite IconAtlas::sprite(const QString &text, const QFont &font, const QColor &color)
+{
+    const QString key = QString("%1|%2|%3").arg(text, font.key()).arg(color.rgba());
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto it = m_sprites.constFind(key); it != m_sprites.constEnd()) {
+            return it.value();
+        }
+    }
+
+    const QFontMetrics fm(font);
+    const QRect bounds = fm.boundingRect(text)
+                             .united(QRect(0, -fm.ascent(), fm.horizontalAdvance(text), fm.height()))
+                             .adjusted(-SPRITE_PADDING, -SPRITE_PADDING, SPRITE_PADDING, SPRITE_PADDING);
+    if (bounds.isEmpty()) {
+        return Sprite();
+    }
+
+    Sprite s;
+    s.origin = -bounds.topLeft();
+    s.image = QImage(bounds.size(), QImage::Format_ARGB32_Premultiplied);
+    s.image.fill(Qt::GlobalColor::transparent);
+    QPainter p(&s.image);
+    p.setRenderHints(QPainter::RenderHint::Antialiasing | QPainter::RenderHint::TextAntialiasing);
+    p.setFont(font);
+    p.setPen(color);
+    p.drawText(s.origin, text);
+    p.end();
+
+    QMutexLocker locker(&m_mutex);
+    if (m_sprites.size() >= SPRITE_CACHE_MAX_CNT) {
+        m_sprites.clear();
+    }
+    m_sprites.insert(key, s);
+    return s;
+}
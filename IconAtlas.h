@@ -0,0 +1,46 @@
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QPoint>
+
+class QPainter;
+
+/*
+ * Colour emoji and icon glyphs rasterized once per (text, font, pen colour) into premultiplied sprites,
+ * then blit by the draw routines, so font fallback and colour bitmap scaling run once per icon size.
+ * Thread safe, sprites are implicitly shared.
+ */
+class IconAtlas
+{
+public:
+    static IconAtlas *instance();
+
+    //same as painter->drawText(baseline, text) with the painter's font and pen
+    void drawText(QPainter *painter, const QPointF &baseline, const QString &text);
+
+    void clear();
+
+private:
+    struct Sprite
+    {
+        QImage image;
+        //baseline origin inside image
+        QPoint origin;
+    };
+
+    IconAtlas();
+    Q_DISABLE_COPY(IconAtlas)
+
+    Sprite sprite(const QString &text, const QFont &font, const QColor &color);
+
+private:
+    QMutex m_mutex;
+    QHash<QString, Sprite> m_sprites;
+};
+
+#endif // ICONATLAS_H
@@ -0,0 +1,141 @@
+#include "ImageDerivative.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QImageReader>
+
+#include <cstring>
+
+#include "Resampler.h"
+
+namespace {
+
+const char DRV_MAGIC[8] = {'Y', 'Q', 'Z', 'D', 'D', 'R', 'V', '1'};
+
+struct DerivativeHeader
+{
+    char magic[8];
+    quint32 width;
+    quint32 height;
+    quint32 format;
+    quint32 bytesPerLine;
+};
+
+} //namespace
+
+QString ImageDerivative::pathFor(const QString &original)
+{
+    return original + QLatin1StringView(".drv");
+}
+
+QString ImageDerivative::lookup(const QString &original)
+{
+    const QFileInfo drv(pathFor(original));
+    if (!drv.exists()) {
+        return QString();
+    }
+    const QFileInfo org(original);
+    if (org.exists() && org.lastModified() > drv.lastModified()) {
+        return QString();
+    }
+    return drv.filePath();
+}
+
+bool ImageDerivative::generate(const QString &original, const QSize &box)
+{
+    if (box.isEmpty()) {
+        return false;
+    }
+    QImageReader reader(original);
+    const QSize size = reader.size();
+    if (!reader.canRead() || !size.isValid()) {
+        //not an image, e.g. audio or video
+        return false;
+    }
+    const QSize target = size.scaled(box, Qt::KeepAspectRatioByExpanding);
+    if (target.width() >= size.width() || target.height() >= size.height()) {
+        QFile::remove(pathFor(original));
+        return false;
+    }
+    QImage img;
+    if (!reader.read(&img)) {
+        qDebug()<<Q_FUNC_INFO<<"decode error "<<original<<", "<<reader.errorString();
+        return false;
+    }
+    img = Resampler::scaled(img, target);
+    return save(img, pathFor(original));
+}
+
+bool ImageDerivative::save(const QImage &img, const QString &file)
+{
+    if (img.isNull()) {
+        return false;
+    }
+    DerivativeHeader header;
+    std::memcpy(header.magic, DRV_MAGIC, sizeof(DRV_MAGIC));
+    header.width        = img.width();
+    header.height       = img.height();
+    header.format       = img.format();
+    header.bytesPerLine = img.bytesPerLine();
+
+    //write aside and rename, a render must never see a partial file
+    const QString tmp = file + QLatin1StringView(".tmp");
+    QFile f(tmp);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"open error "<<tmp;
+        return false;
+    }
+    const bool ok = f.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header)
+                    && f.write(reinterpret_cast<const char *>(img.constBits()), img.sizeInBytes()) == img.sizeInBytes();
+    f.close();
+    if (!ok) {
+        qDebug()<<Q_FUNC_INFO<<"write error "<<tmp;
+        QFile::remove(tmp);
+        return false;
+    }
+    QFile::remove(file);
+    return QFile::rename(tmp, file);
+}
+
+QSize ImageDerivative::size(const QString &file)
+{
+    QFile f(file);
+    DerivativeHeader header;
+    if (!f.open(QIODevice::ReadOnly)
+        || f.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || std::memcmp(header.magic, DRV_MAGIC, sizeof(DRV_MAGIC)) != 0) {
+        return QSize();
+    }
+    return QSize(header.width, header.height);
+}
+
+QImage ImageDerivative::load(const QString &file)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly) || f.size() < (qint64)sizeof(DerivativeHeader)) {
+        return QImage();
+    }
+    const uchar *data = f.map(0, f.size());
+    if (!data) {
+        return QImage();
+    }
+    DerivativeHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, DRV_MAGIC, sizeof(DRV_MAGIC)) != 0
+        || header.format <= QImage::Format_Invalid
+        || header.format >= QImage::NImageFormats) {
+        qDebug()<<Q_FUNC_INFO<<"invalid derivative "<<file;
+        return QImage();
+    }
+    QImage img(header.width, header.height, static_cast<QImage::Format>(header.format));
+    if (img.isNull()
+        || img.bytesPerLine() != (qsizetype)header.bytesPerLine
+        || f.size() < (qint64)(sizeof(header) + img.sizeInBytes())) {
+        qDebug()<<Q_FUNC_INFO<<"invalid derivative "<<file;
+        return QImage();
+    }
+    std::memcpy(img.bits(), data + sizeof(header), img.sizeInBytes());
+    return img;
+}
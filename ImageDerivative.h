@@ -0,0 +1,33 @@
+#ifndef IMAGEDERIVATIVE_H
+#define IMAGEDERIVATIVE_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+/*
+ * Render ready copy of a downloaded image, already downscaled to the largest size any page
+ * draws it and converted to the render pixel format. Stored next to the original as raw
+ * pixels, so loading it is a file map and a copy instead of a decode.
+ * The size is known from the json boxes, a renderer that draws larger decodes the original.
+ */
+class ImageDerivative
+{
+public:
+    static QString pathFor(const QString &original);
+
+    //derivative of original, if it exists and is not older than the original
+    static QString lookup(const QString &original);
+
+    //decode original and downscale it to cover box, no derivative if the original is small enough
+    static bool generate(const QString &original, const QSize &box);
+
+    static bool save(const QImage &img, const QString &file);
+
+    static QImage load(const QString &file);
+
+    //dimensions from the header of a derivative file, invalid if it isn't one
+    static QSize size(const QString &file);
+};
+
+#endif // IMAGEDERIVATIVE_H
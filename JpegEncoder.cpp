@@ -0,0 +1,241 @@
+#include "JpegEncoder.h"
+
+#include <QDebug>
+#include <QBuffer>
+#include <QFile>
+#include <QImageWriter>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cmath>
+#include <utility>
+
+static QMutex s_mutex;
+static JpegOptions s_defaultOptions;
+static JpegSummary s_summary;
+
+QString JpegSummary::toString() const
+{
+    if (pages == 0) {
+        return QStringLiteral("no pages encoded");
+    }
+    return QString("%1 pages, %2 MB, %3 KB/page, quality %4 on average, encoded in %5 ms (%6 ms/page, %7 tries/page)")
+        .arg(pages)
+        .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(bytes / 1024.0 / pages, 0, 'f', 0)
+        .arg(static_cast<double>(qualitySum) / pages, 0, 'f', 1)
+        .arg(msecs)
+        .arg(static_cast<double>(msecs) / pages, 0, 'f', 0)
+        .arg(static_cast<double>(attempts) / pages, 0, 'f', 1);
+}
+
+QJsonObject JpegSummary::toJson() const
+{
+    return QJsonObject {
+        {"pages",       pages},
+        {"bytes",       bytes},
+        {"msecs",       msecs},
+        {"qualitySum",  qualitySum},
+        {"attempts",    attempts},
+    };
+}
+
+JpegSummary JpegSummary::fromJson(const QJsonObject &obj)
+{
+    JpegSummary summary;
+    summary.pages       = obj.value("pages").toInt();
+    summary.bytes       = obj.value("bytes").toInteger();
+    summary.msecs       = obj.value("msecs").toInteger();
+    summary.qualitySum  = obj.value("qualitySum").toInteger();
+    summary.attempts    = obj.value("attempts").toInt();
+    return summary;
+}
+
+void JpegEncoder::setDefaultOptions(const JpegOptions &options)
+{
+    QMutexLocker locker(&s_mutex);
+    s_defaultOptions = options;
+}
+
+JpegOptions JpegEncoder::defaultOptions()
+{
+    QMutexLocker locker(&s_mutex);
+    return s_defaultOptions;
+}
+
+QByteArray JpegEncoder::encodeOnce(const QImage &img, int quality, const JpegOptions &options)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "jpg");
+    writer.setQuality(quality);
+    writer.setOptimizedWrite(options.optimized);
+    writer.setProgressiveScanWrite(options.progressive);
+    if (!writer.write(img)) {
+        qDebug()<<Q_FUNC_INFO<<"encode error "<<writer.errorString();
+        return QByteArray();
+    }
+    return data;
+}
+
+JpegResult JpegEncoder::encode(const QImage &img, const JpegOptions &options)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    JpegResult result;
+    auto encodeAt = [&](int quality) -> QByteArray {
+        result.attempts++;
+        return encodeOnce(img, quality, options);
+    };
+
+    const int maxQuality = qBound(0, options.quality, 100);
+    const int minQuality = qBound(0, options.minQuality, maxQuality);
+    int quality = maxQuality;
+    //encode at quality, only the best candidate of a search is kept, pages are several MB each
+    QByteArray data;
+
+    //quality is monotonic in both PSNR and size, so both are binary searches
+    if (options.minPsnr > 0) {
+        const QImage reference = img.convertToFormat(QImage::Format_RGB32);
+        int lo = minQuality;
+        int hi = maxQuality;
+        //lowest passing quality so far, at hi
+        QByteArray passing;
+        double passingPsnr = -1;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            QByteArray encoded = encodeAt(mid);
+            if (const double p = psnr(reference, QImage::fromData(encoded, "jpg")); p >= options.minPsnr) {
+                hi = mid;
+                passing = std::move(encoded);
+                passingPsnr = p;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        quality = lo;
+        if (passing.isEmpty()) {
+            //nothing below the max quality passed, it isn't tried by the search
+            passing = encodeAt(quality);
+            passingPsnr = psnr(reference, QImage::fromData(passing, "jpg"));
+        }
+        data = std::move(passing);
+        result.psnr = passingPsnr;
+    }
+    if (options.maxBytes > 0) {
+        if (data.isEmpty()) {
+            data = encodeAt(quality);
+        }
+        if (data.size() > options.maxBytes) {
+            int lo = minQuality;
+            int hi = quality - 1;
+            //highest fitting quality so far, at lo
+            QByteArray fitting;
+            while (lo < hi) {
+                const int mid = (lo + hi + 1) / 2;
+                QByteArray encoded = encodeAt(mid);
+                if (encoded.size() <= options.maxBytes) {
+                    lo = mid;
+                    fitting = std::move(encoded);
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            quality = lo;
+            data = fitting.isEmpty() ? encodeAt(quality) : std::move(fitting);
+            //measured at the quality of the PSNR search
+            result.psnr = -1;
+            if (data.size() > options.maxBytes) {
+                qDebug()<<Q_FUNC_INFO<<"quality "<<quality<<" is still over "<<options.maxBytes<<" bytes";
+            }
+        }
+    }
+    if (data.isEmpty()) {
+        data = encodeAt(quality);
+    }
+
+    result.quality = quality;
+    result.data = std::move(data);
+    result.msecs = timer.elapsed();
+    return result;
+}
+
+bool JpegEncoder::save(const QImage &img, const QString &file)
+{
+    return save(img, file, defaultOptions());
+}
+
+bool JpegEncoder::save(const QImage &img, const QString &file, const JpegOptions &options)
+{
+    const auto result = encode(img, options);
+    if (result.data.isEmpty()) {
+        return false;
+    }
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly) || f.write(result.data) != result.data.size()) {
+        qDebug()<<Q_FUNC_INFO<<"write error "<<file;
+        return false;
+    }
+    f.close();
+
+    QMutexLocker locker(&s_mutex);
+    s_summary.pages++;
+    s_summary.bytes += result.data.size();
+    s_summary.msecs += result.msecs;
+    s_summary.qualitySum += result.quality;
+    s_summary.attempts += result.attempts;
+    return true;
+}
+
+JpegSummary JpegEncoder::summary()
+{
+    QMutexLocker locker(&s_mutex);
+    return s_summary;
+}
+
+void JpegEncoder::resetSummary()
+{
+    QMutexLocker locker(&s_mutex);
+    s_summary = JpegSummary();
+}
+
+void JpegEncoder::addToSummary(const JpegSummary &other)
+{
+    QMutexLocker locker(&s_mutex);
+    s_summary.pages += other.pages;
+    s_summary.bytes += other.bytes;
+    s_summary.msecs += other.msecs;
+    s_summary.qualitySum += other.qualitySum;
+    s_summary.attempts += other.attempts;
+}
+
+double JpegEncoder::psnr(const QImage &a, const QImage &b)
+{
+    if (a.size() != b.size() || a.isNull()) {
+        return 0;
+    }
+    const QImage x = a.convertToFormat(QImage::Format_RGB32);
+    const QImage y = b.convertToFormat(QImage::Format_RGB32);
+    double sum = 0;
+    for (int row = 0; row < x.height(); ++row) {
+        const auto *px = reinterpret_cast<const QRgb *>(x.constScanLine(row));
+        const auto *py = reinterpret_cast<const QRgb *>(y.constScanLine(row));
+        qint64 rowSum = 0;
+        for (int col = 0; col < x.width(); ++col) {
+            const int dr = qRed(px[col]) - qRed(py[col]);
+            const int dg = qGreen(px[col]) - qGreen(py[col]);
+            const int db = qBlue(px[col]) - qBlue(py[col]);
+            rowSum += dr * dr + dg * dg + db * db;
+        }
+        sum += rowSum;
+    }
+    const double mse = sum / (3.0 * x.width() * x.height());
+    if (mse <= 0) {
+        //identical
+        return 100;
+    }
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
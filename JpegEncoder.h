@@ -0,0 +1,77 @@
+#ifndef JPEGENCODER_H
+#define JPEGENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QJsonObject>
+#include <QString>
+
+struct JpegOptions
+{
+    //quality of every page, the upper bound of the searches below
+    int quality = 100;
+    //largest page file, the highest quality that fits is used, 0 for no limit
+    qint64 maxBytes = 0;
+    //lowest quality that keeps this PSNR in dB to the rendered page, 0 to keep quality
+    double minPsnr = 0;
+    //floor of both searches
+    int minQuality = 50;
+    //optimized huffman tables, smaller files with the same pixels
+    bool optimized = true;
+    bool progressive = false;
+};
+
+struct JpegResult
+{
+    QByteArray data;
+    int quality = -1;
+    //encodes tried by the search
+    int attempts = 0;
+    //-1 if not measured
+    double psnr = -1;
+    qint64 msecs = 0;
+};
+
+//pages encoded since the last reset
+struct JpegSummary
+{
+    int pages = 0;
+    qint64 bytes = 0;
+    qint64 msecs = 0;
+    qint64 qualitySum = 0;
+    int attempts = 0;
+
+    QString toString() const;
+    QJsonObject toJson() const;
+    static JpegSummary fromJson(const QJsonObject &obj);
+};
+
+/*
+ * Page output, searches the jpeg quality per page for a file size or a PSNR target instead
+ * of always writing quality 100. Encodes in memory, the file is written once.
+ * Thread safe, every saved page is added to a process wide summary.
+ */
+class JpegEncoder
+{
+public:
+    static void setDefaultOptions(const JpegOptions &options);
+    static JpegOptions defaultOptions();
+
+    static JpegResult encode(const QImage &img, const JpegOptions &options);
+
+    static bool save(const QImage &img, const QString &file);
+    static bool save(const QImage &img, const QString &file, const JpegOptions &options);
+
+    static JpegSummary summary();
+    static void resetSummary();
+    //pages encoded by another process
+    static void addToSummary(const JpegSummary &other);
+
+    //peak signal to noise ratio of b to a in dB, both the same size
+    static double psnr(const QImage &a, const QImage &b);
+
+private:
+    static QByteArray encodeOnce(const QImage &img, int quality, const JpegOptions &options);
+};
+
+#endif // JPEGENCODER_H
@@ -7,9 +7,18 @@
 #include <QFileDialog>
 #include <QApplication>
 #include <QMessageBox>
+#include <QDir>
+#include <QFileInfo>
+#include <QPixmap>
+#include <QStatusBar>
 
 #include "MediaDownloader.h"
 #include "PreviewWidget.h"
+#include "BatchScheduler.h"
+#include "BookRenderer.h"
+#include "ThumbnailProvider.h"
+#include "MemoryBudget.h"
+#include "JpegEncoder.h"
 
 #define DEV_DBG 1
 
@@ -18,16 +27,25 @@ MainWindow::MainWindow(QWidget *parent)
     , m_dataSelectBtn(new QPushButton)
     , m_outpathSelectBtn(new QPushButton)
     , m_dlBtn(new QPushButton)
+    , m_qrDlBtn(new QPushButton)
     , m_previewBtn(new QPushButton)
     , m_nextBtn(new QPushButton)
     , m_previousBtn(new QPushButton)
     , m_saveBtn(new QPushButton)
+    , m_pdfBtn(new QPushButton)
+    , m_batchBtn(new QPushButton)
     , m_slider(new QSlider(Qt::Orientation::Horizontal))
+    , m_qrPolicyBox(new QComboBox)
+    , m_thumbStrip(new QListWidget)
+    , m_draftBox(new QCheckBox)
     , m_dataSelLabel(new QLabel)
     , m_outpathSelLabel(new QLabel)
     , m_infoLabel(new QLabel)
+    , m_memLabel(new QLabel)
     , m_previewWidget(new PreviewWidget)
     , m_mediaDL(new MediaDownloader(this))
+    , m_batch(new BatchScheduler(this))
+    , m_thumbs(new ThumbnailProvider(this))
 #ifdef DEV_DBG
     , m_datafile("D:/yqzd-data/json/3-1.json")
     , m_outpath("D:/yqzd-data/3-1")
@@ -39,6 +57,15 @@ MainWindow::MainWindow(QWidget *parent)
     m_slider->setTickPosition(QSlider::TicksBothSides);
     m_slider->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Minimum);
 
+    m_thumbStrip->setViewMode(QListView::IconMode);
+    m_thumbStrip->setFlow(QListView::LeftToRight);
+    m_thumbStrip->setWrapping(false);
+    m_thumbStrip->setMovement(QListView::Static);
+    m_thumbStrip->setUniformItemSizes(true);
+    m_thumbStrip->setIconSize(QSize(m_thumbs->thumbnailWidth(), m_thumbs->thumbnailWidth() * 3 / 2));
+    m_thumbStrip->setFixedHeight(m_thumbs->thumbnailWidth() * 3 / 2 + 40);
+    m_thumbStrip->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+
     auto *vb = new QVBoxLayout;
     vb->setContentsMargins(10, 10, 10, 10);
 
@@ -50,13 +77,26 @@ MainWindow::MainWindow(QWidget *parent)
     vb->addWidget(m_outpathSelectBtn, 0, Qt::AlignLeft);
     vb->addWidget(m_outpathSelLabel, 0, Qt::AlignLeft);
 
+    m_qrPolicyBox->addItem("QR media: eager", QVariant::fromValue(MediaDownloader::QrMediaPolicy::Eager));
+    m_qrPolicyBox->addItem("QR media: lazy", QVariant::fromValue(MediaDownloader::QrMediaPolicy::Lazy));
+    m_qrPolicyBox->addItem("QR media: on request", QVariant::fromValue(MediaDownloader::QrMediaPolicy::OnRequest));
+    m_qrPolicyBox->addItem("QR media: never", QVariant::fromValue(MediaDownloader::QrMediaPolicy::Never));
+    vb->addWidget(m_qrPolicyBox, 0, Qt::AlignLeft);
+
     m_dlBtn->setText("download media");
     vb->addWidget(m_dlBtn, 0, Qt::AlignLeft);
 
+    m_qrDlBtn->setText("download QR media");
+    vb->addWidget(m_qrDlBtn, 0, Qt::AlignLeft);
+
     vb->addWidget(m_infoLabel, 0, Qt::AlignLeft);
 
     m_previewBtn->setText("Preview");
     vb->addWidget(m_previewBtn, 0, Qt::AlignLeft);
+
+    m_draftBox->setText("Draft first");
+    m_draftBox->setChecked(m_previewWidget->isProgressive());
+    vb->addWidget(m_draftBox, 0, Qt::AlignLeft);
     vb->addStretch();
 
     m_nextBtn->setText("Next >>");
@@ -68,6 +108,13 @@ MainWindow::MainWindow(QWidget *parent)
 
     m_saveBtn->setText("Save images");
     vb->addWidget(m_saveBtn, 0, Qt::AlignLeft);
+
+    m_pdfBtn->setText("Export PDF");
+    vb->addWidget(m_pdfBtn, 0, Qt::AlignLeft);
+    vb->addStretch();
+
+    m_batchBtn->setText("Batch render");
+    vb->addWidget(m_batchBtn, 0, Qt::AlignLeft);
     vb->addStretch();
 
     QHBoxLayout *hb = new QHBoxLayout;
@@ -76,11 +123,13 @@ MainWindow::MainWindow(QWidget *parent)
 
     QVBoxLayout *vv = new QVBoxLayout;
     vv->addWidget(m_slider);
+    vv->addWidget(m_thumbStrip);
     vv->addLayout(hb);
 
     auto centralWidget = new QWidget;
     centralWidget->setLayout(vv);
     this->setCentralWidget(centralWidget);
+    this->statusBar()->addPermanentWidget(m_memLabel);
 
     connect(m_dataSelectBtn, &QPushButton::clicked,
             this, [=]() {
@@ -106,11 +155,20 @@ MainWindow::MainWindow(QWidget *parent)
                 m_outpathSelLabel->setText(m_outpath);
             });
 
+    connect(m_draftBox, &QCheckBox::toggled,
+            m_previewWidget, &PreviewWidget::setProgressive);
+
     connect(m_dlBtn, &QPushButton::clicked,
             this, [=]() {
+        m_mediaDL->setQrMediaPolicy(m_qrPolicyBox->currentData().value<MediaDownloader::QrMediaPolicy>());
         m_mediaDL->download(m_datafile, m_outpath);
     });
 
+    connect(m_qrDlBtn, &QPushButton::clicked,
+            this, [=]() {
+        m_mediaDL->fetchDeferred();
+    });
+
     connect(m_previewBtn, &QPushButton::clicked,
             this, [=] {
         // auto w = new PreviewWidget;
@@ -122,6 +180,26 @@ MainWindow::MainWindow(QWidget *parent)
         // m_previewWidget->drawPage(30);
         if (m_previewWidget->load(m_datafile, m_outpath)) {
             m_slider->setMaximum(m_previewWidget->pageCount());
+
+            m_thumbStrip->clear();
+            for (int i=0; i<m_previewWidget->pageCount(); ++i) {
+                m_thumbStrip->addItem(QString::number(i));
+            }
+            m_thumbs->start(m_previewWidget->renderer()->book());
+        }
+    });
+
+    connect(m_thumbs, &ThumbnailProvider::thumbnailReady,
+            this, [=](int pgNum, const QImage &image) {
+        if (auto *item = m_thumbStrip->item(pgNum)) {
+            item->setIcon(QIcon(QPixmap::fromImage(image)));
+        }
+    });
+
+    connect(m_thumbStrip, &QListWidget::currentRowChanged,
+            this, [=](int row) {
+        if (row >= 0) {
+            m_slider->setValue(row);
         }
     });
 
@@ -155,25 +233,109 @@ MainWindow::MainWindow(QWidget *parent)
         m_infoLabel->setText(msg);
     });
 
+    connect(m_mediaDL, &MediaDownloader::downloadFinished,
+            this, [=](const DownloadStats &stats) {
+        m_infoLabel->setText(QString("Downloaded %1 MB in %2 s, %3 KB/s, %4 failed, %5 retries")
+                                 .arg(stats.bytes / 1e6, 0, 'f', 1)
+                                 .arg(stats.elapsedMs / 1000.0, 0, 'f', 1)
+                                 .arg(stats.bytesPerSecond / 1e3, 0, 'f', 0)
+                                 .arg(stats.failed)
+                                 .arg(stats.retries));
+    });
+
+    connect(MemoryBudget::instance(), &MemoryBudget::usageChanged,
+            this, [=](qint64 used, qint64 budget) {
+        m_memLabel->setText(budget > 0 ? QString("Image memory %1 / %2 MB").arg(used >> 20).arg(budget >> 20)
+                                       : QString("Image memory %1 MB").arg(used >> 20));
+    });
+
     connect(m_slider, &QSlider::valueChanged,
             this, [=](int value) {
         if (m_curPageNum != value) {
             m_curPageNum = value;
             m_previewWidget->drawPage(value);
         }
+        if (value < m_thumbStrip->count()) {
+            m_thumbStrip->setCurrentRow(value);
+            m_thumbs->thumbnail(value);
+        }
         m_infoLabel->setText(QLatin1StringView("Page at ") + QString::number(value));
     });
 
     connect(m_saveBtn, &QPushButton::clicked,
             this, [=]() {
         if (m_previewWidget->load(m_datafile, m_outpath)) {
+            JpegEncoder::resetSummary();
             for (int i=0; i<m_previewWidget->pageCount(); ++i) {
                 m_infoLabel->setText(QLatin1StringView("Render page ") + QString::number(i));
                 qApp->processEvents();
                 m_previewWidget->save(i, m_outpath + "/out");
                 qApp->processEvents();
             }
+            m_infoLabel->setText(JpegEncoder::summary().toString());
+        }
+    });
+
+    connect(m_pdfBtn, &QPushButton::clicked,
+            this, [=]() {
+        if (m_previewWidget->load(m_datafile, m_outpath)) {
+            QDir dir;
+            dir.mkpath(m_outpath + "/out");
+            const auto file = QString("%1/out/%2.pdf").arg(m_outpath).arg(QFileInfo(m_datafile).completeBaseName());
+            m_infoLabel->setText(QLatin1StringView("Export ") + file);
+            qApp->processEvents();
+            if (m_previewWidget->exportPdf(file)) {
+                m_infoLabel->setText(QLatin1StringView("Exported ") + file);
+            } else {
+                QMessageBox::warning(nullptr, "Error", QString("Export pdf [%1] error!").arg(file));
+            }
+        }
+    });
+
+    //books in the selected directory, each book's media and images under m_outpath/<book name>
+    connect(m_batchBtn, &QPushButton::clicked,
+            this, [=]() {
+        if (m_batch->isRunning()) {
+            return;
         }
+        if (m_outpath.isEmpty()) {
+            QMessageBox::warning(nullptr, "Error", "Empty out path!");
+            return;
+        }
+        const auto path = QFileDialog::getExistingDirectory(nullptr,
+                                                            "Choose json data path",
+                                                            qApp->applicationDirPath(),
+                                                            QFileDialog::ShowDirsOnly
+                                                                | QFileDialog::DontResolveSymlinks);
+        if (path.isEmpty()) {
+            return;
+        }
+        const auto books = BatchScheduler::booksFor(BatchScheduler::collectBooks(QStringList() << path), m_outpath);
+        JpegEncoder::resetSummary();
+        if (!m_batch->start(books)) {
+            QMessageBox::warning(nullptr, "Error", QString("No book found in [%1]!").arg(path));
+        }
+    });
+
+    connect(m_batch, &BatchScheduler::progress,
+            this, [=](int done, int total, double pagesPerSecond) {
+        m_infoLabel->setText(QString("Batch %1/%2 pages, %3 pages/s")
+                                 .arg(done)
+                                 .arg(total)
+                                 .arg(pagesPerSecond, 0, 'f', 1));
+    });
+
+    connect(m_batch, &BatchScheduler::bookError,
+            this, [=](int book, const QString &msg) {
+        qWarning()<<Q_FUNC_INFO<<"batch book "<<book<<" error "<<msg;
+    });
+
+    connect(m_batch, &BatchScheduler::finished,
+            this, [=](int pages, qint64 msecs) {
+        m_infoLabel->setText(QString("Batch finished, %1 pages in %2 s\n%3")
+                                 .arg(pages)
+                                 .arg(msecs / 1000.0, 0, 'f', 1)
+                                 .arg(JpegEncoder::summary().toString()));
     });
 
 }
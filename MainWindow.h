@@ -5,9 +5,14 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QSlider>
+#include <QComboBox>
+#include <QListWidget>
+#include <QCheckBox>
 
 class PreviewWidget;
 class MediaDownloader;
+class BatchScheduler;
+class ThumbnailProvider;
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -20,21 +25,32 @@ private:
     QPushButton *m_dataSelectBtn    = nullptr;
     QPushButton *m_outpathSelectBtn = nullptr;
     QPushButton *m_dlBtn            = nullptr;
+    QPushButton *m_qrDlBtn          = nullptr;
     QPushButton *m_previewBtn       = nullptr;
     QPushButton *m_nextBtn          = nullptr;
     QPushButton *m_previousBtn      = nullptr;
     QPushButton *m_saveBtn          = nullptr;
+    QPushButton *m_pdfBtn           = nullptr;
+    QPushButton *m_batchBtn         = nullptr;
     QSlider     *m_slider           = nullptr;
+    QComboBox   *m_qrPolicyBox      = nullptr;
+    QListWidget *m_thumbStrip       = nullptr;
+    QCheckBox   *m_draftBox         = nullptr;
 
 
     QLabel      *m_dataSelLabel     = nullptr;
     QLabel      *m_outpathSelLabel  = nullptr;
     QLabel      *m_infoLabel        = nullptr;
+    QLabel      *m_memLabel         = nullptr;
 
     PreviewWidget *m_previewWidget  = nullptr;
 
     MediaDownloader *m_mediaDL      = nullptr;
 
+    BatchScheduler  *m_batch        = nullptr;
+
+    ThumbnailProvider *m_thumbs     = nullptr;
+
     int     m_curPageNum            = 0;
 
     QString m_datafile;
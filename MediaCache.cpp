@@ -0,0 +1,75 @@
+#include "MediaCache.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "MemoryBudget.h"
+
+//TODO magic size, photos of a few pages after derivatives
+const static qsizetype MEDIA_CACHE_MAX_COST = 256 * 1024 * 1024;
+
+MediaCache::MediaCache()
+{
+    m_cache.setMaxCost(MEDIA_CACHE_MAX_COST);
+    MemoryBudget::instance()->addReclaimer([this]() {
+        QMutexLocker locker(&m_mutex);
+        const qint64 bytes = m_cache.totalCost();
+        m_cache.clear();
+        locker.unlock();
+        MemoryBudget::instance()->releaseRetained(bytes);
+        return bytes;
+    });
+}
+
+MediaCache *MediaCache::instance()
+{
+    static MediaCache s_cache;
+    return &s_cache;
+}
+
+QImage MediaCache::find(const QByteArray &key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (auto *img = m_cache.object(key)) {
+        return *img;
+    }
+    return QImage();
+}
+
+void MediaCache::insert(const QByteArray &key, const QImage &img)
+{
+    if (key.isEmpty() || img.isNull()) {
+        return;
+    }
+    const qint64 cost = img.sizeInBytes();
+    //decoded by the render on this thread, its reservation holds the bytes already
+    if (!MemoryBudget::instance()->retain(cost, true)) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    //the cost of the images it evicts is given back, all of it if img is too large to cache
+    const qint64 before = m_cache.totalCost();
+    m_cache.insert(key, new QImage(img), cost);
+    const qint64 freed = before + cost - m_cache.totalCost();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(freed);
+}
+
+void MediaCache::setMaxCost(qsizetype bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 before = m_cache.totalCost();
+    m_cache.setMaxCost(bytes);
+    const qint64 freed = before - m_cache.totalCost();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(freed);
+}
+
+void MediaCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 bytes = m_cache.totalCost();
+    m_cache.clear();
+    locker.unlock();
+    MemoryBudget::instance()->releaseRetained(bytes);
+}
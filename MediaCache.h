@@ -0,0 +1,38 @@
+#ifndef MEDIACACHE_H
+#define MEDIACACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+
+/*
+ * Decoded media keyed by content identity (see ContentIndex), shared by all renderers,
+ * so a photo behind several uris or on several pages is decoded once.
+ * Its cost is retained in the MemoryBudget, which clears it when a render doesn't fit,
+ * an insert over the budget is dropped.
+ * Thread safe, returned images are implicitly shared with the cache.
+ */
+class MediaCache
+{
+public:
+    static MediaCache *instance();
+
+    QImage find(const QByteArray &key);
+
+    void insert(const QByteArray &key, const QImage &img);
+
+    void setMaxCost(qsizetype bytes);
+
+    void clear();
+
+private:
+    MediaCache();
+    Q_DISABLE_COPY(MediaCache)
+
+private:
+    QMutex m_mutex;
+    QCache<QByteArray, QImage> m_cache;
+};
+
+#endif // MEDIACACHE_H
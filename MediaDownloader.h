@@ -3,61 +3,68 @@
 
 
 #include <QObject>
-#include <QMultiMap>
-#include <QSharedDataPointer>
-#include <QNetworkAccessManager>
+#include <QString>
 
-class MediaObjectPriv;
-class MediaObject
+#include "DownloadMetrics.h"
+
+class MediaPipeline;
+/*
+ * Downloads of the window, media are fetched, probed and derived by MediaPipeline::download().
+ * Adds the per request metrics and the signals the UI shows.
+ */
+class MediaDownloader : public QObject
 {
+    Q_OBJECT
 public:
-    MediaObject();
-    MediaObject(const MediaObject &other);
-
-    ~MediaObject();
-
-    MediaObject &operator=(const MediaObject &other);
-    bool operator ==(const MediaObject &other);
-    bool operator !=(const MediaObject &other);
+    //when to fetch media the renderer only uses as QR code text
+    enum class QrMediaPolicy
+    {
+        Eager,      //with all other media, as listed in json
+        Lazy,       //after all drawn media are queued
+        OnRequest,  //only by fetchDeferred()
+        Never
+    };
+    Q_ENUM(QrMediaPolicy)
 
-    QString uri() const;
-
-    void setUri(const QString &newUri);
+    explicit MediaDownloader(QObject *parent = nullptr);
+    virtual ~MediaDownloader();
 
-    int id() const;
+    //false if nothing was started, downloadFinished is emitted otherwise
+    bool download(const QString &dataFile, const QString &outPath);
 
-    void setId(int newId);
+    void setQrMediaPolicy(QrMediaPolicy policy);
 
-    QString path() const;
+    QrMediaPolicy qrMediaPolicy() const;
 
-    void setPath(const QString &path);
+    //download QR only media held back by the last download()
+    void fetchDeferred();
 
-private:
-     QSharedDataPointer<MediaObjectPriv> d;
-};
-
-class MediaDownloader : public QObject
-{
-    Q_OBJECT
-public:
-    explicit MediaDownloader(QObject *parent = nullptr);
-    virtual ~MediaDownloader();
+    int deferredCount() const;
 
-    void download(const QString &dataFile, const QString &outPath);
+    //scale of json sizes to output pixels for render ready derivatives, 0 to disable them
+    void setDerivativeScale(qreal scale);
 
+    DownloadStats stats() const;
 
 Q_SIGNALS:
     void dlError(const QString &errorMsg);
     void downloadState(const QString &msg);
+    //after every finished request
+    void metricsUpdated(const DownloadStats &stats);
+    //all queued media are done, metrics are written to the out path
+    void downloadFinished(const DownloadStats &stats);
 
 private:
-    void processDownload();
+    //download() or fetchDeferred() is done, metrics are written to the out path
+    void finish();
 
 private:
-    QNetworkAccessManager       *m_networkMgr = nullptr;
-    QList<QNetworkReply*>       m_replyList;
-    QList<MediaObject>          m_dlList;
-    QMultiMap<QString, MediaObject>  m_workingMap;
+    MediaPipeline               *m_pipeline = nullptr;
+    QrMediaPolicy               m_qrPolicy = QrMediaPolicy::Eager;
+    QString                     m_outPath;
+    DownloadMetrics             m_metrics;
+    //the pipeline holds the state of one book, a running download is never restarted
+    bool                        m_running = false;
 };
 
 #endif // MEDIADOWNLOADER_H
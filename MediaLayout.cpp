@@ -0,0 +1,282 @@
+#include "MediaLayout.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QJsonArray>
+#include <QJsonValue>
+
+#include <filesystem>
+#include <system_error>
+
+#include "ContentIndex.h"
+#include "ImageDerivative.h"
+#include "MediaProbe.h"
+
+static QAtomicInt s_defaultScheme(static_cast<int>(MediaLayout::Scheme::Flat));
+
+//every uri string below value
+static void collectUris(const QJsonValue &value, int pageId, QMultiHash<QString, int> &ids)
+{
+    if (value.isObject()) {
+        const auto obj = value.toObject();
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+            collectUris(it.value(), pageId, ids);
+        }
+    } else if (value.isArray()) {
+        for (const auto &v : value.toArray()) {
+            collectUris(v, pageId, ids);
+        }
+    } else if (const auto str = value.toString(); str.contains(QLatin1StringView("://"))) {
+        const auto name = MediaLayout::nameOf(str);
+        if (!ids.contains(name, pageId)) {
+            ids.insert(name, pageId);
+        }
+    }
+}
+
+//hard link, a copy if the file system can't link
+static bool linkOrCopy(const QString &from, const QString &to)
+{
+    if (!QDir().mkpath(QFileInfo(to).absolutePath())) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::create_hard_link(std::filesystem::path(from.toStdU16String()),
+                                      std::filesystem::path(to.toStdU16String()),
+                                      ec);
+    return !ec || QFile::copy(from, to);
+}
+
+MediaLayout::MediaLayout(const QString &mediaPath, Scheme scheme)
+    : m_mediaPath(mediaPath)
+    , m_scheme(scheme)
+{
+
+}
+
+MediaLayout MediaLayout::open(const QString &mediaPath)
+{
+    QFile f(markerPathFor(mediaPath));
+    if (f.open(QIODevice::ReadOnly)) {
+        bool ok = false;
+        const auto scheme = schemeFromName(QString::fromUtf8(f.readAll().trimmed()), &ok);
+        if (ok) {
+            return MediaLayout(mediaPath, scheme);
+        }
+        qDebug()<<Q_FUNC_INFO<<"unknown layout in "<<f.fileName();
+    }
+    return MediaLayout(mediaPath, defaultScheme());
+}
+
+void MediaLayout::setDefaultScheme(Scheme scheme)
+{
+    s_defaultScheme.storeRelaxed(static_cast<int>(scheme));
+}
+
+MediaLayout::Scheme MediaLayout::defaultScheme()
+{
+    return static_cast<Scheme>(s_defaultScheme.loadRelaxed());
+}
+
+QString MediaLayout::schemeName(Scheme scheme)
+{
+    switch (scheme) {
+    case Scheme::PerId:
+        return QStringLiteral("id");
+    case Scheme::HashPrefix:
+        return QStringLiteral("hash");
+    default:
+        return QStringLiteral("flat");
+    }
+}
+
+MediaLayout::Scheme MediaLayout::schemeFromName(const QString &name, bool *ok)
+{
+    if (ok) {
+        *ok = true;
+    }
+    if (name == QLatin1StringView("id")) {
+        return Scheme::PerId;
+    }
+    if (name == QLatin1StringView("hash")) {
+        return Scheme::HashPrefix;
+    }
+    if (ok && name != QLatin1StringView("flat")) {
+        *ok = false;
+    }
+    return Scheme::Flat;
+}
+
+QString MediaLayout::nameOf(const QString &uri)
+{
+    QString ext;
+    if (int idx = uri.lastIndexOf("."); idx >=0) {
+        ext = uri.sliced(idx+1);
+    }
+    return QString("%1.%2")
+        .arg(QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex())
+        .arg(ext);
+}
+
+QMultiHash<QString, int> MediaLayout::pageIds(const QJsonObject &data)
+{
+    QMultiHash<QString, int> ids;
+    collectUris(data.value("Profile"), -1, ids);
+    for (const auto &page : data.value("Pages").toArray()) {
+        const auto obj = page.toObject();
+        if (const int id = obj.value("ID").toInt(-1); id != -1) {
+            collectUris(obj, id, ids);
+        }
+    }
+    return ids;
+}
+
+bool MediaLayout::migrate(const QString &mediaPath, Scheme scheme, const QMultiHash<QString, int> &pageIds)
+{
+    const MediaLayout from = open(mediaPath);
+    const MediaLayout to(mediaPath, scheme);
+    if (scheme == Scheme::PerId && pageIds.isEmpty()) {
+        qDebug()<<Q_FUNC_INFO<<"page ids of the book are needed for the id layout";
+        return false;
+    }
+
+    ContentIndex index(mediaPath);
+    const bool indexed = index.load();
+    //probes are keyed by path too, they move with their files
+    MediaProbeIndex probes(mediaPath);
+    const bool probed = probes.load();
+
+    //derivatives (<name>.drv) are not matched, they move with their original
+    static const QRegularExpression MEDIA_NAME("^[0-9a-f]{32}\\.[^./]*$");
+    QStringList files;
+    QDirIterator it(mediaPath, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (MEDIA_NAME.match(it.fileName()).hasMatch()) {
+            files.append(it.filePath());
+        }
+    }
+
+    int moved = 0;
+    int failed = 0;
+    for (const auto &file : files) {
+        const QString name = QFileInfo(file).fileName();
+        QStringList targets;
+        if (scheme == Scheme::PerId) {
+            for (const int id : pageIds.values(name)) {
+                targets.append(to.fileOfName(name, id));
+            }
+        } else {
+            targets.append(to.fileOfName(name, -1));
+        }
+        if (targets.isEmpty()) {
+            qDebug()<<Q_FUNC_INFO<<"no page references "<<file<<", left as is";
+            continue;
+        }
+
+        const QByteArray hash = index.identity(file);
+        bool ok = true;
+        bool keep = false;
+        for (const auto &target : targets) {
+            if (QFileInfo(target) == QFileInfo(file)) {
+                keep = true;
+                continue;
+            }
+            //same name is the same uri, e.g. a page directory of the id layout merged into flat
+            if (!QFile::exists(target) && !linkOrCopy(file, target)) {
+                qDebug()<<Q_FUNC_INFO<<"can't move "<<file<<" to "<<target;
+                ok = false;
+                continue;
+            }
+            if (const auto drv = ImageDerivative::lookup(file); !drv.isEmpty()) {
+                const auto targetDrv = ImageDerivative::pathFor(target);
+                if (!QFile::exists(targetDrv)) {
+                    linkOrCopy(drv, targetDrv);
+                }
+            }
+            if (!hash.isEmpty()) {
+                index.insert(target, hash);
+            }
+            if (probes.contains(file)) {
+                probes.insert(target, probes.value(file));
+            }
+        }
+        if (!ok) {
+            failed++;
+            continue;
+        }
+        if (!keep) {
+            QFile::remove(ImageDerivative::pathFor(file));
+            QFile::remove(file);
+            index.remove(file);
+            probes.remove(file);
+            //directories of the old layout left empty
+            QDir dir = QFileInfo(file).absoluteDir();
+            while (dir != QDir(mediaPath) && dir.isEmpty() && dir.rmdir(dir.absolutePath())) {
+                dir.cdUp();
+            }
+        }
+        moved++;
+    }
+
+    if (indexed) {
+        index.save();
+    }
+    if (probed) {
+        probes.save();
+    }
+    qDebug()<<Q_FUNC_INFO<<schemeName(from.scheme())<<" -> "<<schemeName(scheme)<<", "
+             <<moved<<" files moved, "<<failed<<" failed";
+    //most files are in the new layout now, failed ones are listed above and downloaded again
+    return to.save() && failed == 0;
+}
+
+QString MediaLayout::mediaPath() const
+{
+    return m_mediaPath;
+}
+
+MediaLayout::Scheme MediaLayout::scheme() const
+{
+    return m_scheme;
+}
+
+QString MediaLayout::file(const QString &uri, int pageId) const
+{
+    return fileOfName(nameOf(uri), pageId);
+}
+
+QString MediaLayout::fileOfName(const QString &name, int pageId) const
+{
+    switch (m_scheme) {
+    case Scheme::PerId:
+        return QString("%1/%2/%3").arg(m_mediaPath).arg(pageId).arg(name);
+    case Scheme::HashPrefix:
+        return QString("%1/%2/%3/%4").arg(m_mediaPath, name.left(2), name.mid(2, 2), name);
+    default:
+        return QString("%1/%2").arg(m_mediaPath, name);
+    }
+}
+
+bool MediaLayout::save() const
+{
+    QSaveFile f(markerPathFor(m_mediaPath));
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"can't write "<<f.fileName();
+        return false;
+    }
+    f.write(schemeName(m_scheme).toUtf8() + '\n');
+    return f.commit();
+}
+
+QString MediaLayout::markerPathFor(const QString &mediaPath)
+{
+    return QDir(mediaPath).filePath("media.layout");
+}
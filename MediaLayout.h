@@ -0,0 +1,71 @@
+#ifndef MEDIALAYOUT_H
+#define MEDIALAYOUT_H
+
+#include <QJsonObject>
+#include <QMultiHash>
+#include <QString>
+
+/*
+ * Where the downloaded file of a media uri is stored below a media path, shared by
+ * MediaPipeline and BookRenderer. Files are named <md5 of uri>.<extension>, the scheme
+ * only decides the directories. The scheme of a media path is kept in <media path>/media.layout,
+ * media paths without it use the default scheme.
+ */
+class MediaLayout
+{
+public:
+    enum class Scheme
+    {
+        Flat,       //<media>/<name>
+        PerId,      //<media>/<page id>/<name>
+        HashPrefix  //<media>/ab/cd/abcd....jpg, bounds the entries of one directory
+    };
+
+    MediaLayout() = default;
+    MediaLayout(const QString &mediaPath, Scheme scheme);
+
+    //layout recorded in mediaPath, the default scheme if none is recorded
+    static MediaLayout open(const QString &mediaPath);
+
+    //scheme of media paths without a recorded layout
+    static void setDefaultScheme(Scheme scheme);
+    static Scheme defaultScheme();
+
+    //"flat", "id" or "hash"
+    static QString schemeName(Scheme scheme);
+    static Scheme schemeFromName(const QString &name, bool *ok = nullptr);
+
+    //file name of uri in every scheme, <md5 of uri>.<extension>
+    static QString nameOf(const QString &uri);
+
+    //file names referenced by book data to the ids of the pages referencing them, -1 for the profile
+    static QMultiHash<QString, int> pageIds(const QJsonObject &data);
+
+    /*
+     * move the media files of mediaPath from its recorded layout to scheme, derivatives and
+     * the content index move along. PerId needs pageIds of the book, a file referenced by
+     * several pages is linked into each page directory
+     */
+    static bool migrate(const QString &mediaPath, Scheme scheme,
+                        const QMultiHash<QString, int> &pageIds = QMultiHash<QString, int>());
+
+    QString mediaPath() const;
+
+    Scheme scheme() const;
+
+    QString file(const QString &uri, int pageId) const;
+
+    QString fileOfName(const QString &name, int pageId) const;
+
+    //record the scheme in the media path
+    bool save() const;
+
+private:
+    static QString markerPathFor(const QString &mediaPath);
+
+private:
+    QString m_mediaPath;
+    Scheme m_scheme = Scheme::Flat;
+};
+
+#endif // MEDIALAYOUT_H
@@ -0,0 +1,275 @@
+#include "MediaPack.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMap>
+#include <QRegularExpression>
+
+#include <cstring>
+
+#include "ContentIndex.h"
+#include "MediaProbe.h"
+
+namespace {
+
+//version 1 had no modification times, its packs are not opened and loose files are read
+const char PACK_MAGIC[8] = {'Y', 'Q', 'Z', 'D', 'P', 'C', 'K', '2'};
+
+const int KEY_SIZE = 16;
+
+struct PackHeader
+{
+    char magic[8];
+    quint32 count;
+    quint32 reserved;
+};
+
+//sorted by key, offsets are from the start of the file
+struct PackEntry
+{
+    char key[KEY_SIZE];
+    quint64 offset;
+    //size of the packed file
+    quint64 length;
+    //of the packed file, msecs since epoch
+    qint64 modified;
+};
+
+//md5 of the uri, the hex name of a downloaded file
+QByteArray keyOf(const QString &file)
+{
+    const QString name = QFileInfo(file).fileName();
+    if (name.size() < KEY_SIZE * 2) {
+        return QByteArray();
+    }
+    const QByteArray key = QByteArray::fromHex(name.left(KEY_SIZE * 2).toLatin1());
+    return key.size() == KEY_SIZE ? key : QByteArray();
+}
+
+} //namespace
+
+static QAtomicInt s_writeEnabled = 0;
+
+QString MediaPack::packPathFor(const QString &mediaPath)
+{
+    return QDir(mediaPath).filePath("media.pack");
+}
+
+void MediaPack::setWriteEnabled(bool enabled)
+{
+    s_writeEnabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+bool MediaPack::writeEnabled()
+{
+    return s_writeEnabled.loadRelaxed();
+}
+
+bool MediaPack::write(const QString &packFile, const QStringList &files, const ContentIndex &contents)
+{
+    //key to file, sorted as the index
+    QMap<QByteArray, QString> byKey;
+    for (const auto &file : files) {
+        if (const auto key = keyOf(file); !key.isEmpty() && QFileInfo::exists(file)) {
+            byKey.insert(key, file);
+        }
+    }
+
+    //blobs in key order, a file with the content of an earlier one points to its blob
+    QList<PackEntry> entries;
+    QStringList blobs;
+    QHash<QByteArray, int> blobOfHash;
+    quint64 offset = sizeof(PackHeader) + sizeof(PackEntry) * byKey.size();
+    for (auto it = byKey.constBegin(); it != byKey.constEnd(); ++it) {
+        const QFileInfo info(it.value());
+        PackEntry entry;
+        std::memcpy(entry.key, it.key().constData(), KEY_SIZE);
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+        const QByteArray hash = contents.identity(it.value());
+        if (const int blob = blobOfHash.value(hash, -1); !hash.isEmpty() && blob >= 0) {
+            entry.offset = entries.at(blob).offset;
+            entry.length = entries.at(blob).length;
+        } else {
+            entry.offset = offset;
+            entry.length = info.size();
+            offset += entry.length;
+            if (!hash.isEmpty()) {
+                blobOfHash.insert(hash, entries.size());
+            }
+            blobs.append(it.value());
+        }
+        entries.append(entry);
+    }
+
+    QSaveFile f(packFile);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"can't write "<<packFile;
+        return false;
+    }
+    PackHeader header;
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.count = entries.size();
+    header.reserved = 0;
+    f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    f.write(reinterpret_cast<const char *>(entries.constData()), sizeof(PackEntry) * entries.size());
+
+    //TODO magic
+    const static qint64 CHUNK_SIZE = 1024 * 1024;
+    for (const auto &blob : blobs) {
+        QFile in(blob);
+        if (!in.open(QIODevice::ReadOnly)) {
+            qDebug()<<Q_FUNC_INFO<<"can't read "<<blob;
+            f.cancelWriting();
+            return false;
+        }
+        const qint64 expected = in.size();
+        qint64 copied = 0;
+        while (!in.atEnd()) {
+            copied += f.write(in.read(CHUNK_SIZE));
+        }
+        if (copied != expected) {
+            //changed while packing, the offsets in the index would be wrong
+            qDebug()<<Q_FUNC_INFO<<"size of "<<blob<<" changed";
+            f.cancelWriting();
+            return false;
+        }
+    }
+    if (!f.commit()) {
+        qDebug()<<Q_FUNC_INFO<<"commit error "<<packFile<<", "<<f.errorString();
+        return false;
+    }
+    qDebug()<<Q_FUNC_INFO<<packFile<<", "<<entries.size()<<" media in "<<blobs.size()<<" blobs, "
+             <<offset<<" bytes";
+    return true;
+}
+
+bool MediaPack::writeMediaPath(const QString &mediaPath)
+{
+    //downloaded files in any layout, derivatives and indices are left out
+    static const QRegularExpression MEDIA_NAME("^[0-9a-f]{32}\\.[^./]*$");
+    MediaProbeIndex probes(mediaPath);
+    probes.load();
+    QStringList files;
+    QDirIterator it(mediaPath, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (!MEDIA_NAME.match(it.fileName()).hasMatch()) {
+            continue;
+        }
+        //not probed yet is packed, e.g. media downloaded before validation existed
+        if (probes.contains(it.filePath()) && !probes.value(it.filePath()).valid) {
+            qDebug()<<Q_FUNC_INFO<<"leave out broken "<<it.filePath();
+            continue;
+        }
+        files.append(it.filePath());
+    }
+    ContentIndex contents(mediaPath);
+    contents.load();
+    return write(packPathFor(mediaPath), files, contents);
+}
+
+bool MediaPack::open(const QString &packFile)
+{
+    m_file.reset();
+    m_base = nullptr;
+    m_size = 0;
+    m_count = 0;
+
+    auto file = QSharedPointer<QFile>::create(packFile);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const qint64 size = file->size();
+    if (size < static_cast<qint64>(sizeof(PackHeader))) {
+        qDebug()<<Q_FUNC_INFO<<"invalid pack "<<packFile;
+        return false;
+    }
+    const uchar *base = file->map(0, size);
+    if (!base) {
+        qDebug()<<Q_FUNC_INFO<<"map error "<<packFile<<", "<<file->errorString();
+        return false;
+    }
+    PackHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0
+        || sizeof(PackHeader) + sizeof(PackEntry) * static_cast<quint64>(header.count) > static_cast<quint64>(size)) {
+        qDebug()<<Q_FUNC_INFO<<"invalid pack "<<packFile;
+        return false;
+    }
+    m_file = file;
+    m_base = base;
+    m_size = size;
+    m_count = header.count;
+    return true;
+}
+
+bool MediaPack::isOpen() const
+{
+    return m_base != nullptr;
+}
+
+int MediaPack::count() const
+{
+    return m_count;
+}
+
+bool MediaPack::contains(const QString &file) const
+{
+    return entry(file) != nullptr;
+}
+
+QByteArray MediaPack::data(const QString &file) const
+{
+    const uchar *e = entry(file);
+    if (!e) {
+        return QByteArray();
+    }
+    PackEntry entry;
+    std::memcpy(&entry, e, sizeof(entry));
+    if (entry.offset > static_cast<quint64>(m_size) || entry.length > static_cast<quint64>(m_size) - entry.offset) {
+        qDebug()<<Q_FUNC_INFO<<"truncated pack "<<m_file->fileName();
+        return QByteArray();
+    }
+    //a pack may be shipped without the loose files, only a different one shadows it
+    if (const QFileInfo info(file); info.exists()
+        && (static_cast<quint64>(info.size()) != entry.length
+            || info.lastModified().toMSecsSinceEpoch() != entry.modified)) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_base + entry.offset), entry.length);
+}
+
+const uchar *MediaPack::entry(const QString &file) const
+{
+    if (!m_base) {
+        return nullptr;
+    }
+    const QByteArray key = keyOf(file);
+    if (key.isEmpty()) {
+        return nullptr;
+    }
+    const uchar *index = m_base + sizeof(PackHeader);
+    int lo = 0;
+    int hi = m_count - 1;
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        const uchar *e = index + sizeof(PackEntry) * mid;
+        const int cmp = std::memcmp(e, key.constData(), KEY_SIZE);
+        if (cmp == 0) {
+            return e;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,63 @@
+#ifndef MEDIAPACK_H
+#define MEDIAPACK_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class QFile;
+class ContentIndex;
+
+/*
+ * All downloaded media of a book in one uncompressed file, <media path>/media.pack, so shipping
+ * and opening a book's media is one sequential file instead of thousands of small ones.
+ * An index sorted by the md5 of the uri (the name of the downloaded file, see MediaLayout)
+ * maps to offset, length and the modification time of the packed file. Reading maps the file,
+ * data() points into the mapping. A loose file that differs from its entry, e.g. downloaded
+ * again after the pack was written, is read instead of the stale packed bytes.
+ */
+class MediaPack
+{
+public:
+    MediaPack() = default;
+
+    static QString packPathFor(const QString &mediaPath);
+
+    //write a pack after every download, see MediaDownloader
+    static void setWriteEnabled(bool enabled);
+    static bool writeEnabled();
+
+    /*
+     * pack downloaded files into packFile, files with the same name are stored once,
+     * files with the same content hash in contents share one blob
+     */
+    static bool write(const QString &packFile, const QStringList &files, const ContentIndex &contents);
+
+    //pack every downloaded file below mediaPath, files probed as broken are left out
+    static bool writeMediaPath(const QString &mediaPath);
+
+    bool open(const QString &packFile);
+
+    bool isOpen() const;
+
+    int count() const;
+
+    bool contains(const QString &file) const;
+
+    //bytes of the downloaded file, without a copy, null if the pack doesn't hold it or holds an older one
+    QByteArray data(const QString &file) const;
+
+private:
+    //entry of file, nullptr if none
+    const uchar *entry(const QString &file) const;
+
+private:
+    //shared by copies, the mapping lives as long as the file
+    QSharedPointer<QFile> m_file;
+    const uchar *m_base = nullptr;
+    qint64 m_size = 0;
+    int m_count = 0;
+};
+
+#endif // MEDIAPACK_H
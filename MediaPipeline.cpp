@@ -0,0 +1,474 @@
+#include "MediaPipeline.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include <filesystem>
+
+#include "BookJson.h"
+#include "DownloadPolicy.h"
+#include "ImageDerivative.h"
+#include "MediaPack.h"
+
+//canon holds the same bytes already, link file to it, else write data
+static bool linkOrWrite(const QString &file, const QString &canon, const QByteArray &data)
+{
+    if (!QDir().mkpath(QFileInfo(file).absolutePath())) {
+        qDebug()<<Q_FUNC_INFO<<"mk dir error "<<file;
+        return false;
+    }
+    //file may be a hard link from an earlier download, never write through it
+    QFile::remove(file);
+    if (!canon.isEmpty() && QFile::exists(canon)) {
+        std::error_code ec;
+        std::filesystem::create_hard_link(std::filesystem::path(canon.toStdU16String()),
+                                          std::filesystem::path(file.toStdU16String()),
+                                          ec);
+        if (!ec) {
+            return true;
+        }
+    }
+    QFile f(file);
+    if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size()) {
+        qDebug()<<Q_FUNC_INFO<<"write error "<<file;
+        return false;
+    }
+    return true;
+}
+
+//link file to canon, a copy where hard links aren't supported
+static bool linkOrCopy(const QString &file, const QString &canon)
+{
+    QFile::remove(file);
+    std::error_code ec;
+    std::filesystem::create_hard_link(std::filesystem::path(canon.toStdU16String()),
+                                      std::filesystem::path(file.toStdU16String()),
+                                      ec);
+    return !ec || QFile::copy(canon, file);
+}
+
+MediaPipeline::MediaPipeline(QObject *parent)
+    : QObject{parent}
+    , m_networkMgr(new QNetworkAccessManager(this))
+    , m_concurrency(DL_MAX_CNT)
+{
+
+}
+
+MediaPipeline::~MediaPipeline()
+{
+    //coroutines still suspended are leaked with their frames, cancel and await run() first
+    if (!m_replies.isEmpty()) {
+        qDebug()<<Q_FUNC_INFO<<"destroyed while running";
+    }
+    m_pool.waitForDone();
+}
+
+void MediaPipeline::setConcurrency(int count)
+{
+    m_concurrency = qMax(1, count);
+}
+
+void MediaPipeline::setThreadCount(int count)
+{
+    if (count > 0) {
+        m_pool.setMaxThreadCount(count);
+    }
+}
+
+void MediaPipeline::setDerivativeScale(qreal scale)
+{
+    m_derivativeScale = scale;
+}
+
+void MediaPipeline::setQrMediaPolicy(MediaDownloader::QrMediaPolicy policy)
+{
+    m_qrPolicy = policy;
+}
+
+void MediaPipeline::cancel()
+{
+    m_cancelled.storeRelaxed(1);
+    //finished is emitted for every aborted reply, its coroutine sees the flag then
+    const auto replies = m_replies;
+    for (auto reply : replies) {
+        reply->abort();
+    }
+}
+
+bool MediaPipeline::isCancelled() const
+{
+    return m_cancelled.loadRelaxed();
+}
+
+Coro::Task<bool> MediaPipeline::run(QList<BatchBook> books)
+{
+    m_cancelled.storeRelaxed(0);
+    bool ok = true;
+    for (const auto &book : books) {
+        if (m_cancelled.loadRelaxed()) {
+            co_return false;
+        }
+        if (!co_await runBook(book)) {
+            Q_EMIT pipelineError(QString("Book [%1] failed").arg(book.jsonPath));
+            ok = false;
+        }
+    }
+    co_return ok;
+}
+
+Coro::Task<bool> MediaPipeline::runBook(BatchBook book)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!co_await download(book.jsonPath, book.mediaPath)) {
+        co_return false;
+    }
+
+    //the renderer reads the indexes saved above
+    const auto loaded = co_await Coro::runOn(&m_pool, this, [book]() -> std::optional<BookData> {
+        BookRenderer renderer;
+        if (!renderer.load(book.jsonPath, book.mediaPath)) {
+            return std::nullopt;
+        }
+        return renderer.book();
+    });
+    if (!loaded) {
+        Q_EMIT pipelineError(QString("Error to load book [%1]!").arg(book.jsonPath));
+        co_return false;
+    }
+
+    const int pageCount = loaded->pages.count();
+    Q_EMIT pipelineState(QString("Rendering %1 pages of [%2]").arg(pageCount).arg(book.jsonPath));
+    {
+        //one range per thread, a renderer keeps its scene and caches across its pages
+        const int ranges = qMax(1, qMin(m_pool.maxThreadCount(), pageCount));
+        const int perRange = (pageCount + ranges - 1) / ranges;
+        Coro::TaskGroup group;
+        for (int from = 0; from < pageCount; from += perRange) {
+            group.spawn(renderRange(*loaded, from, qMin(pageCount, from + perRange), book.outPath));
+        }
+        co_await group.wait();
+    }
+    if (m_cancelled.loadRelaxed()) {
+        co_return false;
+    }
+
+    Q_EMIT pipelineState(QString("Book [%1] done in %2 ms, %3 pages failed")
+                             .arg(book.jsonPath)
+                             .arg(timer.elapsed())
+                             .arg(m_failedPages));
+    co_return m_failedPages == 0;
+}
+
+Coro::Task<bool> MediaPipeline::download(QString jsonPath, QString mediaPath)
+{
+    if (!QDir().mkpath(mediaPath)) {
+        Q_EMIT pipelineError(QString("Error to create path [%1]!").arg(mediaPath));
+        co_return false;
+    }
+
+    QString error;
+    const auto data = co_await Coro::runOn(&m_pool, this, [jsonPath, &error]() {
+        return BookJson::loadData(jsonPath, &error);
+    });
+    if (data.isEmpty()) {
+        Q_EMIT pipelineError(error);
+        co_return false;
+    }
+
+    QHash<QString, MediaRef> media;
+    collectMedia(data.value("Profile"), -1, media);
+    for (const auto &page : data.value("Pages").toArray()) {
+        const auto obj = page.toObject();
+        if (const int id = obj.value("ID").toInt(-1); id != -1) {
+            collectMedia(obj, id, media);
+        }
+    }
+
+    m_mediaPath = mediaPath;
+    m_layout = MediaLayout::open(mediaPath);
+    m_layout.save();
+    m_contents = ContentIndex(mediaPath);
+    m_contents.load();
+    m_probes = MediaProbeIndex(mediaPath);
+    m_probes.load();
+    m_failedMedia = 0;
+    m_failedPages = 0;
+    m_deferred.clear();
+
+    //QR only media is fetched with the rest, after it, on request or not at all, see QrMediaPolicy
+    QHash<QString, MediaRef> lazy;
+    int skipped = 0;
+    if (m_qrPolicy != MediaDownloader::QrMediaPolicy::Eager) {
+        for (auto it = media.begin(); it != media.end();) {
+            if (it->drawn) {
+                ++it;
+                continue;
+            }
+            if (m_qrPolicy == MediaDownloader::QrMediaPolicy::Lazy) {
+                lazy.insert(it.key(), it.value());
+            } else if (m_qrPolicy == MediaDownloader::QrMediaPolicy::OnRequest) {
+                m_deferred.insert(it.key(), it.value());
+            } else {
+                skipped++;
+            }
+            it = media.erase(it);
+        }
+    }
+
+    Q_EMIT pipelineState(QString("Downloading %1 media of [%2], %3 QR media deferred, %4 skipped")
+                             .arg(media.size())
+                             .arg(jsonPath)
+                             .arg(lazy.size() + m_deferred.size())
+                             .arg(skipped));
+    co_await fetchMedia({media, lazy});
+    if (m_cancelled.loadRelaxed()) {
+        co_return false;
+    }
+    if (m_failedMedia > 0) {
+        //pages are rendered anyway, broken media is skipped
+        Q_EMIT pipelineError(QString("%1 media of [%2] failed").arg(m_failedMedia).arg(jsonPath));
+    }
+    co_return true;
+}
+
+Coro::Task<bool> MediaPipeline::fetchDeferred()
+{
+    const auto deferred = std::exchange(m_deferred, {});
+    m_failedMedia = 0;
+    co_await fetchMedia({deferred});
+    if (m_cancelled.loadRelaxed()) {
+        co_return false;
+    }
+    if (m_failedMedia > 0) {
+        Q_EMIT pipelineError(QString("%1 QR media of [%2] failed").arg(m_failedMedia).arg(m_mediaPath));
+    }
+    co_return true;
+}
+
+int MediaPipeline::deferredCount() const
+{
+    return m_deferred.size();
+}
+
+Coro::Task<void> MediaPipeline::fetchMedia(QList<QHash<QString, MediaRef>> batches)
+{
+    {
+        Coro::Semaphore downloads(m_concurrency, this);
+        m_downloads = &downloads;
+        for (const auto &batch : batches) {
+            Coro::TaskGroup group;
+            for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+                group.spawn([](MediaPipeline *self, QString uri, MediaRef ref) -> Coro::Task<void> {
+                    if (!co_await self->fetch(uri, ref)) {
+                        self->m_failedMedia++;
+                    }
+                }(this, it.key(), it.value()));
+            }
+            co_await group.wait();
+        }
+        m_downloads = nullptr;
+    }
+    m_contents.save();
+    m_probes.save();
+    if (m_cancelled.loadRelaxed()) {
+        co_return;
+    }
+    //whole media path, so media of earlier downloads stay in the pack
+    if (MediaPack::writeEnabled()) {
+        if (!co_await Coro::runOn(&m_pool, this, [mediaPath = m_mediaPath]() {
+                return MediaPack::writeMediaPath(mediaPath);
+            })) {
+            Q_EMIT pipelineError(QString("Error to write media pack of [%1]!").arg(m_mediaPath));
+        }
+    }
+}
+
+QSize MediaPipeline::renderBox(const QJsonObject &obj)
+{
+    const int w = qMax(obj.value("Width").toDouble(), obj.value("WPixel").toDouble());
+    const int h = qMax(obj.value("Height").toDouble(), obj.value("HPixel").toDouble());
+    const int s = qMax(w, h);
+    return s > 0 ? QSize(s, s) : QSize();
+}
+
+void MediaPipeline::collectMedia(const QJsonValue &value, int pageId, QHash<QString, MediaRef> &media)
+{
+    if (value.isArray()) {
+        for (const auto &v : value.toArray()) {
+            collectMedia(v, pageId, media);
+        }
+        return;
+    }
+    if (!value.isObject()) {
+        return;
+    }
+    const auto obj = value.toObject();
+    const QSize box = renderBox(obj);
+    for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        const auto str = it.value().toString();
+        if (!str.contains(QLatin1StringView("://"))) {
+            collectMedia(it.value(), pageId, media);
+            continue;
+        }
+        auto &ref = media[str];
+        if (!ref.pageIds.contains(pageId)) {
+            ref.pageIds.append(pageId);
+        }
+        if (BookRenderer::mediaUsage(it.key()) == BookRenderer::MediaUsage::Drawn) {
+            ref.drawn = true;
+            if (!box.isEmpty()) {
+                ref.box = ref.box.expandedTo(box);
+            }
+        }
+    }
+}
+
+Coro::Task<bool> MediaPipeline::fetch(QString uri, MediaRef ref)
+{
+    QStringList files;
+    for (const int id : ref.pageIds) {
+        files.append(m_layout.file(uri, id));
+    }
+
+    //failed requests and invalid bodies are counted apart, see DownloadPolicy.h
+    int failures = 0;
+    int invalid = 0;
+    while (true) {
+        if (m_cancelled.loadRelaxed()) {
+            co_return false;
+        }
+
+        QByteArray body;
+        qint64 expectedSize = -1;
+        bool failed = false;
+        QString error;
+        {
+            auto permit = co_await m_downloads->acquire();
+            if (m_cancelled.loadRelaxed()) {
+                co_return false;
+            }
+            QNetworkReply *reply = m_networkMgr->get(QNetworkRequest(QUrl(uri)));
+            m_replies.insert(reply);
+            Q_EMIT requestStarted(reply, uri);
+            co_await Coro::finished(reply);
+            m_replies.remove(reply);
+            reply->deleteLater();
+
+            if (reply->error() != QNetworkReply::NoError) {
+                failed = true;
+                error = reply->errorString();
+            } else {
+                body = reply->readAll();
+            }
+            Q_EMIT requestFinished(reply, body.size());
+            //the body is decoded by QNetworkAccessManager, the length is of the encoded one then
+            if (const auto encoding = reply->rawHeader("Content-Encoding");
+                encoding.isEmpty() || encoding == "identity") {
+                const auto length = reply->header(QNetworkRequest::ContentLengthHeader);
+                expectedSize = length.isValid() ? length.toLongLong() : -1;
+            }
+        }
+        //aborted by cancel()
+        if (m_cancelled.loadRelaxed()) {
+            co_return false;
+        }
+        //the permit is released above, a backoff doesn't hold a download slot
+        if (failed) {
+            qDebug()<<Q_FUNC_INFO<<"download error "<<uri<<" "<<error;
+            if (++failures >= DL_MAX_TRY) {
+                Q_EMIT pipelineError(QString("Download of [%1] failed after %2 tries: %3")
+                                         .arg(uri)
+                                         .arg(failures)
+                                         .arg(error));
+                co_return false;
+            }
+            Q_EMIT pipelineState(QString("Retry failed download of %1").arg(uri));
+            co_await Coro::sleep(this, dlRetryDelay(failures));
+            continue;
+        }
+
+        const QByteArray hash = co_await Coro::runOn(&m_pool, this, [body]() {
+            return ContentIndex::hashOf(body);
+        });
+        //same bytes behind another uri become hard links, see ContentIndex
+        const QString canon = m_contents.canonical(hash);
+        const auto probe = co_await Coro::runOn(&m_pool, this, [files, canon, body, expectedSize]() {
+            for (const auto &file : files) {
+                if (!linkOrWrite(file, canon.isEmpty() ? files.first() : canon, body)) {
+                    MediaProbe failed;
+                    failed.error = QLatin1StringView("can't write");
+                    return failed;
+                }
+            }
+            return MediaProbe::probe(files.first(), expectedSize);
+        });
+        for (const auto &file : files) {
+            m_probes.insert(file, probe);
+        }
+        if (!probe.valid) {
+            qDebug()<<Q_FUNC_INFO<<"invalid "<<uri<<" "<<probe.error;
+            if (++invalid >= DL_MAX_TRY) {
+                Q_EMIT pipelineError(QString("Invalid media [%1] after %2 tries: %3")
+                                         .arg(uri)
+                                         .arg(invalid)
+                                         .arg(probe.error));
+                co_return false;
+            }
+            Q_EMIT pipelineState(QString("Retry invalid download of %1, %2").arg(uri, probe.error));
+            co_await Coro::sleep(this, dlRetryDelay(invalid));
+            continue;
+        }
+        for (const auto &file : files) {
+            m_contents.insert(file, hash);
+        }
+
+        //decode and downscale once here instead of on every render
+        if (!ref.box.isEmpty() && m_derivativeScale > 0) {
+            const QSize target = ref.box * m_derivativeScale;
+            co_await Coro::runOn(&m_pool, this, [files, target]() {
+                //files are links of the same bytes, decoded once, the others link its derivative
+                const bool derived = ImageDerivative::generate(files.first(), target);
+                const QString drv = ImageDerivative::pathFor(files.first());
+                for (int i=1; i<files.size(); ++i) {
+                    const QString path = ImageDerivative::pathFor(files.at(i));
+                    if (!derived) {
+                        QFile::remove(path);
+                    } else if (!linkOrCopy(path, drv)) {
+                        qDebug()<<Q_FUNC_INFO<<"link error "<<path;
+                    }
+                }
+            });
+        }
+        co_return true;
+    }
+}
+
+Coro::Task<void> MediaPipeline::renderRange(BookData book, int from, int to, QString outPath)
+{
+    const int failed = co_await Coro::runOn(&m_pool, this, [this, book, from, to, outPath]() {
+        BookRenderer renderer;
+        renderer.setBook(book);
+        int failed = 0;
+        for (int page = from; page < to && !m_cancelled.loadRelaxed(); ++page) {
+            if (!renderer.save(page, outPath)) {
+                failed++;
+            }
+        }
+        return failed;
+    });
+    m_failedPages += failed;
+}
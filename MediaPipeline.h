@@ -0,0 +1,120 @@
+#ifndef MEDIAPIPELINE_H
+#define MEDIAPIPELINE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+
+#include "Coroutine.h"
+#include "BatchScheduler.h"
+#include "BookRenderer.h"
+#include "ContentIndex.h"
+#include "MediaDownloader.h"
+#include "MediaLayout.h"
+#include "MediaProbe.h"
+
+class QJsonObject;
+class QJsonValue;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/*
+ * Download, validate, derive and render of books as straight-line coroutines, see Coroutine.h.
+ * Every uri is one fetch() coroutine, downloads are bounded by a semaphore and file work runs
+ * on the pool, so the GUI thread never blocks or nests an event loop. cancel() aborts the
+ * replies in flight, every coroutine then returns at its next step.
+ * MediaDownloader drives download() for the window and reports to the UI per request.
+ */
+class MediaPipeline : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaPipeline(QObject *parent = nullptr);
+    virtual ~MediaPipeline();
+
+    //parallel downloads
+    void setConcurrency(int count);
+
+    //file and render threads
+    void setThreadCount(int count);
+
+    //scale of json sizes to output pixels for render ready derivatives, 0 to disable them
+    void setDerivativeScale(qreal scale);
+
+    //media only hashed into QR codes, OnRequest holds it back for fetchDeferred()
+    void setQrMediaPolicy(MediaDownloader::QrMediaPolicy policy);
+
+    //media of a book into mediaPath, false if the json can't be read or it was cancelled.
+    //Media given up on is reported by pipelineError, the book is usable without it
+    Coro::Task<bool> download(QString jsonPath, QString mediaPath);
+
+    //QR only media held back by the last download()
+    Coro::Task<bool> fetchDeferred();
+
+    int deferredCount() const;
+
+    //books one after another, true if all of them are done
+    Coro::Task<bool> run(QList<BatchBook> books);
+
+    Coro::Task<bool> runBook(BatchBook book);
+
+    void cancel();
+
+    bool isCancelled() const;
+
+Q_SIGNALS:
+    void pipelineError(const QString &errorMsg);
+    void pipelineState(const QString &msg);
+    //every request of download() and fetchDeferred(), reply is valid until the slots return
+    void requestStarted(QNetworkReply *reply, const QString &uri);
+    //bytes of the body, 0 for a failed request
+    void requestFinished(QNetworkReply *reply, qint64 bytes);
+
+private:
+    struct MediaRef
+    {
+        QList<int> pageIds;
+        //largest box any page draws the uri in, empty if it's never drawn
+        QSize box;
+        //any page draws it, else it's only QR code text
+        bool drawn = false;
+    };
+
+    //box an image object is drawn in, square of the larger side as some pages draw it rotated
+    static QSize renderBox(const QJsonObject &obj);
+
+    static void collectMedia(const QJsonValue &value, int pageId, QHash<QString, MediaRef> &media);
+
+    //batches one after another, then the indexes and the pack of the book are written
+    Coro::Task<void> fetchMedia(QList<QHash<QString, MediaRef>> batches);
+
+    //download uri into the files of its pages, probe and derive it
+    Coro::Task<bool> fetch(QString uri, MediaRef ref);
+
+    Coro::Task<void> renderRange(BookData book, int from, int to, QString outPath);
+
+private:
+    QNetworkAccessManager   *m_networkMgr = nullptr;
+    QThreadPool             m_pool;
+    int                     m_concurrency;
+    qreal                   m_derivativeScale = 1.0;
+    MediaDownloader::QrMediaPolicy m_qrPolicy = MediaDownloader::QrMediaPolicy::Eager;
+    //read by the render threads
+    QAtomicInt              m_cancelled;
+    QSet<QNetworkReply*>    m_replies;
+    //state of the book in download()
+    Coro::Semaphore         *m_downloads = nullptr;
+    QString                 m_mediaPath;
+    QHash<QString, MediaRef> m_deferred;
+    MediaLayout             m_layout;
+    ContentIndex            m_contents;
+    MediaProbeIndex         m_probes;
+    int                     m_failedMedia = 0;
+    int                     m_failedPages = 0;
+};
+
+#endif // MEDIAPIPELINE_H
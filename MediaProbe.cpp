@@ -0,0 +1,163 @@
+#include "MediaProbe.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+//bytes searched for the end marker, encoders may pad after it
+const static qint64 TAIL_SIZE = 64;
+
+//last bytes of a complete file of format, empty if format has no fixed end
+static QByteArray endMarker(const QByteArray &format)
+{
+    if (format == "jpeg" || format == "jpg") {
+        return QByteArray("\xFF\xD9", 2);
+    }
+    if (format == "png") {
+        return QByteArray("IEND\xAE\x42\x60\x82", 8);
+    }
+    return QByteArray();
+}
+
+MediaProbe MediaProbe::probe(const QString &file, qint64 expectedSize)
+{
+    MediaProbe probe;
+    probe.expectedSize = expectedSize;
+
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        probe.error = QLatin1StringView("can't open");
+        return probe;
+    }
+    probe.size = f.size();
+    if (probe.size == 0) {
+        probe.error = QLatin1StringView("empty");
+        return probe;
+    }
+    if (expectedSize >= 0 && probe.size != expectedSize) {
+        probe.error = QString("size %1, expected %2").arg(probe.size).arg(expectedSize);
+        return probe;
+    }
+
+    QImageReader reader(&f);
+    const QByteArray suffix = QFileInfo(file).suffix().toLower().toLatin1();
+    if (!reader.canRead()) {
+        //a suffix of an image format without an image header is a broken download
+        if (QImageReader::supportedImageFormats().contains(suffix)) {
+            probe.error = QString("not a %1 image").arg(QString::fromLatin1(suffix));
+            return probe;
+        }
+        probe.valid = true;
+        return probe;
+    }
+    probe.format = reader.format();
+    probe.dimensions = reader.size();
+    if (!probe.dimensions.isValid()) {
+        probe.error = QLatin1StringView("invalid header, ") + reader.errorString();
+        return probe;
+    }
+
+    if (const QByteArray marker = endMarker(probe.format); !marker.isEmpty()) {
+        f.seek(qMax<qint64>(0, probe.size - TAIL_SIZE));
+        if (!f.readAll().contains(marker)) {
+            probe.error = QLatin1StringView("truncated");
+            return probe;
+        }
+    }
+    probe.valid = true;
+    return probe;
+}
+
+MediaProbeIndex::MediaProbeIndex(const QString &mediaPath)
+    : m_mediaPath(QDir(mediaPath).absolutePath())
+{
+
+}
+
+QString MediaProbeIndex::indexPathFor(const QString &mediaPath)
+{
+    return QDir(mediaPath).filePath("media.probe");
+}
+
+bool MediaProbeIndex::load()
+{
+    m_probes.clear();
+    QFile f(indexPathFor(m_mediaPath));
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const auto root = QJsonDocument::fromJson(f.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const auto obj = it.value().toObject();
+        MediaProbe probe;
+        probe.size          = obj.value("Size").toInteger();
+        probe.expectedSize  = obj.value("ExpectedSize").toInteger(-1);
+        probe.dimensions    = QSize(obj.value("Width").toInt(-1), obj.value("Height").toInt(-1));
+        probe.format        = obj.value("Format").toString().toLatin1();
+        probe.valid         = obj.value("Valid").toBool();
+        probe.error         = obj.value("Error").toString();
+        m_probes.insert(it.key(), probe);
+    }
+    return true;
+}
+
+bool MediaProbeIndex::save() const
+{
+    QJsonObject root;
+    for (auto it = m_probes.constBegin(); it != m_probes.constEnd(); ++it) {
+        const auto &probe = it.value();
+        QJsonObject obj;
+        obj.insert("Size", probe.size);
+        obj.insert("ExpectedSize", probe.expectedSize);
+        if (probe.dimensions.isValid()) {
+            obj.insert("Width", probe.dimensions.width());
+            obj.insert("Height", probe.dimensions.height());
+        }
+        if (!probe.format.isEmpty()) {
+            obj.insert("Format", QString::fromLatin1(probe.format));
+        }
+        obj.insert("Valid", probe.valid);
+        if (!probe.error.isEmpty()) {
+            obj.insert("Error", probe.error);
+        }
+        root.insert(it.key(), obj);
+    }
+
+    QSaveFile f(indexPathFor(m_mediaPath));
+    if (!f.open(QIODevice::WriteOnly)) {
+        qDebug()<<Q_FUNC_INFO<<"can't write "<<f.fileName();
+        return false;
+    }
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return f.commit();
+}
+
+bool MediaProbeIndex::contains(const QString &file) const
+{
+    return m_probes.contains(relative(file));
+}
+
+MediaProbe MediaProbeIndex::value(const QString &file) const
+{
+    return m_probes.value(relative(file));
+}
+
+void MediaProbeIndex::insert(const QString &file, const MediaProbe &probe)
+{
+    m_probes.insert(relative(file), probe);
+}
+
+void MediaProbeIndex::remove(const QString &file)
+{
+    m_probes.remove(relative(file));
+}
+
+QString MediaProbeIndex::relative(const QString &file) const
+{
+    return QDir(m_mediaPath).relativeFilePath(QFileInfo(file).absoluteFilePath());
+}
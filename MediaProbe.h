@@ -0,0 +1,60 @@
+#ifndef MEDIAPROBE_H
+#define MEDIAPROBE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSize>
+#include <QString>
+
+/*
+ * Result of checking a downloaded file without decoding it: size against the Content-Length
+ * of the reply, image header and dimensions, and the end marker of jpeg and png files,
+ * which a truncated download misses.
+ */
+struct MediaProbe
+{
+    qint64 size = 0;
+    //Content-Length of the reply, -1 if unknown
+    qint64 expectedSize = -1;
+    //invalid for media that isn't an image, e.g. audio or video
+    QSize dimensions;
+    QByteArray format;
+    bool valid = false;
+    QString error;
+
+    static MediaProbe probe(const QString &file, qint64 expectedSize = -1);
+};
+
+/*
+ * Probes of the downloaded media of one media path, kept in <media path>/media.probe
+ * so the renderer knows the dimensions and broken files without opening them again.
+ */
+class MediaProbeIndex
+{
+public:
+    MediaProbeIndex() = default;
+    explicit MediaProbeIndex(const QString &mediaPath);
+
+    static QString indexPathFor(const QString &mediaPath);
+
+    bool load();
+    bool save() const;
+
+    bool contains(const QString &file) const;
+
+    MediaProbe value(const QString &file) const;
+
+    void insert(const QString &file, const MediaProbe &probe);
+
+    void remove(const QString &file);
+
+private:
+    QString relative(const QString &file) const;
+
+private:
+    QString m_mediaPath;
+    //path relative to m_mediaPath
+    QHash<QString, MediaProbe> m_probes;
+};
+
+#endif // MEDIAPROBE_H
@@ -0,0 +1,223 @@
+#include "MemoryBudget.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+//see setThreadReservation()
+static thread_local MemoryReservation *s_threadReservation = nullptr;
+
+MemoryBudget::MemoryBudget(QObject *parent)
+    : QObject(parent)
+{
+
+}
+
+MemoryBudget *MemoryBudget::instance()
+{
+    static MemoryBudget s_budget;
+    return &s_budget;
+}
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_budget = qMax<qint64>(0, bytes);
+    }
+    m_released.wakeAll();
+}
+
+qint64 MemoryBudget::budget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+qint64 MemoryBudget::used() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_used + m_retained;
+}
+
+qint64 MemoryBudget::peak() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_peak;
+}
+
+bool MemoryBudget::fits(qint64 bytes) const
+{
+    return m_budget == 0 || m_used + m_retained + bytes <= m_budget;
+}
+
+bool MemoryBudget::reclaim(QMutexLocker<QMutex> &locker, qint64 bytes)
+{
+    if (m_retained == 0 || m_reclaimers.isEmpty()) {
+        return fits(bytes);
+    }
+    //reclaimers take their own locks and report through releaseRetained(), they must not run under ours
+    const auto reclaimers = m_reclaimers;
+    locker.unlock();
+    qint64 freed = 0;
+    for (const auto &r : reclaimers) {
+        freed += r();
+    }
+    qDebug()<<Q_FUNC_INFO<<"over budget, caches freed "<<freed<<" bytes";
+    locker.relock();
+    return fits(bytes);
+}
+
+MemoryReservation MemoryBudget::grant(QMutexLocker<QMutex> &locker, qint64 bytes)
+{
+    m_used += bytes;
+    m_peak = qMax(m_peak, m_used + m_retained);
+    const qint64 used = m_used + m_retained;
+    const qint64 budget = m_budget;
+    locker.unlock();
+
+    Q_EMIT usageChanged(used, budget);
+    return MemoryReservation(bytes);
+}
+
+MemoryReservation MemoryBudget::reserve(qint64 bytes)
+{
+    if (bytes <= 0) {
+        return MemoryReservation();
+    }
+    QMutexLocker locker(&m_mutex);
+    while (!fits(bytes)) {
+        //caches may fill again while waiting, they are asked again after every release
+        if (reclaim(locker, bytes)) {
+            break;
+        }
+        //nothing else reserved, a request larger than the budget can't fit any better by waiting
+        if (m_used == 0) {
+            break;
+        }
+        m_released.wait(&m_mutex);
+    }
+    return grant(locker, bytes);
+}
+
+bool MemoryBudget::tryReserve(qint64 bytes, MemoryReservation *reservation)
+{
+    if (bytes <= 0) {
+        *reservation = MemoryReservation();
+        return true;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!fits(bytes) && !reclaim(locker, bytes) && m_used > 0) {
+        return false;
+    }
+    *reservation = grant(locker, bytes);
+    return true;
+}
+
+void MemoryBudget::addReclaimer(const std::function<qint64()> &reclaimer)
+{
+    QMutexLocker locker(&m_mutex);
+    m_reclaimers.append(reclaimer);
+}
+
+bool MemoryBudget::retain(qint64 bytes, bool reserved)
+{
+    if (bytes <= 0) {
+        return true;
+    }
+    qint64 used = 0;
+    qint64 budget = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        //only the reservation's own thread changes it
+        const qint64 moved = reserved && s_threadReservation ? qMin(bytes, s_threadReservation->m_bytes) : 0;
+        if (!fits(bytes - moved)) {
+            return false;
+        }
+        if (moved > 0) {
+            s_threadReservation->m_bytes -= moved;
+            m_used -= moved;
+        }
+        m_retained += bytes;
+        m_peak = qMax(m_peak, m_used + m_retained);
+        used = m_used + m_retained;
+        budget = m_budget;
+    }
+    Q_EMIT usageChanged(used, budget);
+    return true;
+}
+
+void MemoryBudget::releaseRetained(qint64 bytes)
+{
+    if (bytes <= 0) {
+        return;
+    }
+    qint64 used = 0;
+    qint64 budget = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_retained = qMax<qint64>(0, m_retained - bytes);
+        used = m_used + m_retained;
+        budget = m_budget;
+    }
+    m_released.wakeAll();
+    Q_EMIT usageChanged(used, budget);
+}
+
+void MemoryBudget::setThreadReservation(MemoryReservation *reservation)
+{
+    s_threadReservation = reservation;
+}
+
+void MemoryBudget::release(qint64 bytes)
+{
+    qint64 used = 0;
+    qint64 budget = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_used -= bytes;
+        used = m_used + m_retained;
+        budget = m_budget;
+    }
+    m_released.wakeAll();
+    Q_EMIT usageChanged(used, budget);
+}
+
+MemoryReservation::MemoryReservation(qint64 bytes)
+    : m_bytes(bytes)
+{
+
+}
+
+MemoryReservation::MemoryReservation(MemoryReservation &&other) noexcept
+    : m_bytes(other.m_bytes)
+{
+    other.m_bytes = 0;
+}
+
+MemoryReservation &MemoryReservation::operator=(MemoryReservation &&other) noexcept
+{
+    if (this != &other) {
+        reset();
+        m_bytes = other.m_bytes;
+        other.m_bytes = 0;
+    }
+    return *this;
+}
+
+MemoryReservation::~MemoryReservation()
+{
+    reset();
+}
+
+qint64 MemoryReservation::bytes() const
+{
+    return m_bytes;
+}
+
+void MemoryReservation::reset()
+{
+    if (m_bytes > 0) {
+        MemoryBudget::instance()->release(m_bytes);
+        m_bytes = 0;
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+#include <functional>
+
+class MemoryReservation;
+
+/*
+ * Process wide budget of image memory shared by all renderers.
+ * A render reserves its target image and the decoded media of its page in one call and holds
+ * nothing else, so waiting for other renders to release always makes progress. Caches ask before
+ * they retain bytes and are refused above the budget, retained bytes count until the reclaimers
+ * free them. Media a render decodes is already in its reservation, caching it moves the bytes
+ * from the reservation to the cache instead of counting them twice.
+ * A reservation that doesn't fit first asks the caches to give memory back, then waits.
+ * The budget is never exceeded, except by a single reservation larger than the whole budget
+ * and by a GUI thread render that can't be skipped, see BookRenderer::renderPage().
+ * Thread safe, usageChanged may be emitted from any thread.
+ */
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+public:
+    static MemoryBudget *instance();
+
+    //in bytes, 0 for no limit
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+
+    //reserved and retained by caches
+    qint64 used() const;
+    qint64 peak() const;
+
+    //blocks until bytes fit in the budget, never on the GUI thread, see tryReserve()
+    MemoryReservation reserve(qint64 bytes);
+
+    //reserve without waiting, false if bytes don't fit even after the caches are freed
+    bool tryReserve(qint64 bytes, MemoryReservation *reservation);
+
+    //callback frees retained memory, e.g. clears a cache, returns the freed bytes
+    void addReclaimer(const std::function<qint64()> &reclaimer);
+
+    /*
+     * a cache is about to keep bytes, false if they don't fit, it must not keep them then.
+     * reserved: decoded under the reservation of this thread's render, the bytes move out of it
+     */
+    bool retain(qint64 bytes, bool reserved = false);
+
+    //bytes a cache evicted or cleared
+    void releaseRetained(qint64 bytes);
+
+    //reservation of the render running on this thread, nullptr when it's done
+    static void setThreadReservation(MemoryReservation *reservation);
+
+Q_SIGNALS:
+    void usageChanged(qint64 used, qint64 budget);
+
+private:
+    explicit MemoryBudget(QObject *parent = nullptr);
+    Q_DISABLE_COPY(MemoryBudget)
+
+    friend class MemoryReservation;
+    void release(qint64 bytes);
+
+    //m_mutex is locked, it's unlocked while the reclaimers run
+    bool fits(qint64 bytes) const;
+    bool reclaim(QMutexLocker<QMutex> &locker, qint64 bytes);
+    MemoryReservation grant(QMutexLocker<QMutex> &locker, qint64 bytes);
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_released;
+    qint64 m_budget = 0;
+    //reservations of renders
+    qint64 m_used = 0;
+    //kept by caches, freed by m_reclaimers
+    qint64 m_retained = 0;
+    qint64 m_peak = 0;
+    QList<std::function<qint64()>> m_reclaimers;
+};
+
+//bytes held in the MemoryBudget until destroyed or reset
+class MemoryReservation
+{
+public:
+    MemoryReservation() = default;
+    MemoryReservation(MemoryReservation &&other) noexcept;
+    MemoryReservation &operator=(MemoryReservation &&other) noexcept;
+    ~MemoryReservation();
+
+    qint64 bytes() const;
+
+    void reset();
+
+private:
+    friend class MemoryBudget;
+    explicit MemoryReservation(qint64 bytes);
+    Q_DISABLE_COPY(MemoryReservation)
+
+    qint64 m_bytes = 0;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,45 @@
+#include "PixelFormatPolicy.h"
+
+#include <QDebug>
+
+QImage::Format PixelFormatPolicy::sceneFormat()
+{
+    return QImage::Format_RGB32;
+}
+
+QImage::Format PixelFormatPolicy::mediaFormat(const QImage &img)
+{
+    return img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+}
+
+bool PixelFormatPolicy::normalize(QImage &img)
+{
+    if (img.isNull()) {
+        return false;
+    }
+    if (const auto fmt = mediaFormat(img); img.format() != fmt) {
+        img.convertTo(fmt);
+        m_conversions++;
+        return true;
+    }
+    return false;
+}
+
+bool PixelFormatPolicy::load(QImage &img, const QString &file)
+{
+    if (!img.load(file)) {
+        return false;
+    }
+    normalize(img);
+    return true;
+}
+
+int PixelFormatPolicy::conversions() const
+{
+    return m_conversions;
+}
+
+void PixelFormatPolicy::resetConversions()
+{
+    m_conversions = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef PIXELFORMATPOLICY_H
+#define PIXELFORMATPOLICY_H
+
+#include <QImage>
+#include <QString>
+
+/*
+ * Pixel formats used through the render pipeline, so QPainter stays on its fast paths:
+ * the page is opaque (saved as JPEG) and uses RGB32, decoded media is converted once after
+ * load to RGB32 or ARGB32_Premultiplied.
+ */
+class PixelFormatPolicy
+{
+public:
+    static QImage::Format sceneFormat();
+
+    static QImage::Format mediaFormat(const QImage &img);
+
+    //convert img to mediaFormat(), return true if a conversion was needed
+    bool normalize(QImage &img);
+
+    bool load(QImage &img, const QString &file);
+
+    int conversions() const;
+
+    void resetConversions();
+
+private:
+    int m_conversions = 0;
+};
+
+#endif // PIXELFORMATPOLICY_H
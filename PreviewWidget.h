@@ -3,10 +3,16 @@
 
 #include <QWidget>
 #include <QImage>
-#include <QJsonArray>
+#include <QAtomicInt>
+#include <QThreadPool>
 
-#include "PropertyData.h"
+class BookRenderer;
 
+/*
+ * Shows one page scaled to the widget. In progressive mode a draft at widget resolution
+ * is rendered and shown right away, the full quality page is rendered in the background
+ * and replaces the draft when it's done.
+ */
 class PreviewWidget : public QWidget
 {
     Q_OBJECT
@@ -22,63 +28,41 @@ public:
 
     void save(int pgNum, const QString &path);
 
-    QImage generateBarcode(const QString &text, int width, int height,
-                           QColor foreground = Qt::black,
-                           QColor background = Qt::white);
+    //render all pages as one vector pdf document, text is kept as glyphs
+    bool exportPdf(const QString &file);
 
-    QString generateBarcodeText(const QString &uri) const;
+    //full quality renderer, not rendering in the background when returned
+    BookRenderer *renderer();
+
+    //draft first, then full quality, default on
+    void setProgressive(bool progressive);
+    bool isProgressive() const;
 
     // QWidget interface
 protected:
     virtual void paintEvent(QPaintEvent *event) Q_DECL_OVERRIDE;
 
-protected:
-    virtual bool parseProperty(const QJsonObject &obj);
-    virtual void renderToImage(int pgNum);
-
-private:
-    void drawIntroPage(const QJsonObject &node);
-    void drawVersionPage(const QJsonObject &node);
-    void drawDirectoryPage(const QJsonObject &node);
-    void drawProfilePage(const QJsonObject &node);
-    void drawGraduationPhotoPage(const QJsonObject &node);
-    void drawGraduationMoviePaget(const QJsonObject &node);
-    void drawGraduationDreamPage(const QJsonObject &node);
-    void drawHybridSubject(const QJsonObject &node, const QJsonObject &property);
-    void drawFeedPage(const QJsonObject &node, const QJsonObject &property);
-    void drawPhysicalExaminationPage(const QJsonObject &node, const QJsonObject &property);
-    void drawEWishPage(const QJsonObject &node, const QJsonObject &property);
-    void drawGraduationAudios(const QJsonObject &node, const QJsonObject &property);
-    void drawEFinalPage(const QJsonObject &node, const QJsonObject &property);
-
-
-    void drawPagination(const QJsonObject &node);
-
-    void drawBackground(const QJsonObject &PropertyObject);
-    void drawElement(const QJsonObject &node);
-    void drawTemplateElement(const QJsonObject &node);
-
 private:
-    QString dotExtension(const QString &uri) const;
+    //drop pending full renders and wait for the running one
+    void waitForRenderer();
 
-private:
-    QImage *m_sceneImg = nullptr;
-    QPainter *m_scenePainter = nullptr;
-
-    int m_curID = -1;
-    QString m_mediaPath;
-    QString m_profileAvatar;
-
-    PageSize m_pageSize;
+    void renderFull(int generation, int pgNum, const QSize &size);
 
-    QJsonArray m_pages;
-    DividingLine m_dvLine;
-    Pagination m_pagination;
-
-    // SubjectFonts m_subjectFonts;
+    //draft or full quality page, unless a newer page was requested meanwhile
+    void showFrame(int generation, const QImage &frame);
 
+private:
+    BookRenderer *m_renderer = nullptr;
+    //same book, only renders drafts on the GUI thread
+    BookRenderer *m_draftRenderer = nullptr;
+    bool m_progressive = true;
 
+    //one full render at a time, always on m_renderer
+    QThreadPool m_pool;
+    //bumped by every page request, older full renders are dropped
+    QAtomicInt m_generation;
 
+    QImage m_frame;
 };
 
 
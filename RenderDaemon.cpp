@@ -0,0 +1,223 @@
+#include "RenderDaemon.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThread>
+
+#include "BookRenderer.h"
+#include "JpegEncoder.h"
+
+RenderDaemon::RenderDaemon(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    connect(m_server, &QLocalServer::newConnection,
+            this, &RenderDaemon::onNewConnection);
+}
+
+RenderDaemon::~RenderDaemon()
+{
+    m_stopping.storeRelease(1);
+    m_pool.waitForDone();
+}
+
+void RenderDaemon::setThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount());
+}
+
+bool RenderDaemon::listen(const QString &name)
+{
+    //a stale socket file is left if the last daemon crashed
+    QLocalServer::removeServer(name);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!m_server->listen(name)) {
+        qWarning()<<Q_FUNC_INFO<<"listen on "<<name<<" error "<<m_server->errorString();
+        return false;
+    }
+    qInfo()<<"render daemon listening on "<<m_server->fullServerName()
+           <<" with "<<m_pool.maxThreadCount()<<" threads";
+    return true;
+}
+
+void RenderDaemon::onNewConnection()
+{
+    while (auto *socket = m_server->nextPendingConnection()) {
+        auto client = std::make_shared<Client>();
+        client->socket = socket;
+        m_clients.insert(socket, client);
+        connect(socket, &QLocalSocket::readyRead,
+                this, [this, client]() {
+            onReadyRead(client);
+        });
+        connect(socket, &QLocalSocket::disconnected,
+                this, [this, socket, client]() {
+            client->gone.storeRelease(1);
+            m_clients.remove(socket);
+            socket->deleteLater();
+            quitIfDone();
+        });
+    }
+}
+
+void RenderDaemon::onReadyRead(const ClientPtr &client)
+{
+    QLocalSocket *socket = client->socket;
+    while (socket && socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const auto doc = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+            send(client, QJsonObject { {"event", "error"},
+                                       {"message", QString("parse json error at offset [%1]!").arg(error.offset)} });
+            continue;
+        }
+        handleMessage(client, doc.object());
+    }
+}
+
+void RenderDaemon::handleMessage(const ClientPtr &client, const QJsonObject &msg)
+{
+    if (msg.value("cmd").toString() == QLatin1StringView("quit")) {
+        qInfo()<<"render daemon quit requested, "<<m_jobs<<" jobs running";
+        //running jobs go on, their replies are delivered by this event loop
+        m_quitting = true;
+        m_server->close();
+        quitIfDone();
+        return;
+    }
+    const auto id = msg.value("id");
+    if (m_quitting) {
+        send(client, QJsonObject { {"id", id}, {"event", "error"}, {"message", "daemon is stopping"} });
+        return;
+    }
+    if (msg.value("json").toString().isEmpty()
+        || msg.value("media").toString().isEmpty()
+        || msg.value("out").toString().isEmpty()) {
+        send(client, QJsonObject { {"id", id}, {"event", "error"}, {"message", "json, media and out are required"} });
+        return;
+    }
+    send(client, QJsonObject { {"id", id}, {"event", "accepted"} });
+
+    m_jobs++;
+    m_pool.start([this, client, msg]() {
+        runJob(client, msg);
+        //queued after the job's replies, so they are written first
+        QMetaObject::invokeMethod(this, &RenderDaemon::onJobDone, Qt::QueuedConnection);
+    });
+}
+
+void RenderDaemon::onJobDone()
+{
+    m_jobs--;
+    quitIfDone();
+}
+
+void RenderDaemon::quitIfDone()
+{
+    if (!m_quitting || m_quitEmitted || m_jobs > 0) {
+        return;
+    }
+    //replies still buffered would be lost when the application quits
+    for (const auto &client : std::as_const(m_clients)) {
+        if (client->socket && client->socket->bytesToWrite() > 0) {
+            connect(client->socket, &QLocalSocket::bytesWritten,
+                    this, &RenderDaemon::quitIfDone, Qt::UniqueConnection);
+            return;
+        }
+    }
+    m_quitEmitted = true;
+    Q_EMIT quitRequested();
+}
+
+void RenderDaemon::runJob(const ClientPtr &client, const QJsonObject &job)
+{
+    const auto id = job.value("id");
+    auto fail = [&](const QString &message) {
+        send(client, QJsonObject { {"id", id}, {"event", "error"}, {"message", message} });
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString out = job.value("out").toString();
+    if (!QDir().mkpath(out)) {
+        fail(QString("Error to create path [%1]!").arg(out));
+        return;
+    }
+    BookRenderer renderer;
+    if (!renderer.load(job.value("json").toString(), job.value("media").toString())) {
+        fail(QString("Load book [%1] error!").arg(job.value("json").toString()));
+        return;
+    }
+
+    const QString format = job.value("format").toString("jpg").toLower();
+    if (format == QLatin1StringView("pdf")) {
+        const auto file = QDir(out).filePath(QFileInfo(job.value("json").toString()).completeBaseName() + ".pdf");
+        const bool ok = renderer.exportPdf(file);
+        if (!ok) {
+            fail(QString("Export pdf [%1] error!").arg(file));
+        }
+        send(client, QJsonObject { {"id", id}, {"event", "finished"}, {"ok", ok}, {"file", file},
+                                   {"pages", renderer.pageCount()}, {"msecs", timer.elapsed()} });
+        return;
+    }
+
+    const int pages = renderer.pageCount();
+    const int first = qBound(0, job.value("first").toInt(0), pages - 1);
+    int last = job.value("last").toInt(-1);
+    last = (last < 0 || last >= pages) ? pages - 1 : last;
+    const int total = qMax(0, last - first + 1);
+
+    int done = 0;
+    bool ok = true;
+    for (int i=first; i<=last; ++i) {
+        if (m_stopping.loadAcquire()) {
+            fail("daemon is stopping");
+            return;
+        }
+        //nobody to report to, the rest of the job is dropped
+        if (client->gone.loadAcquire()) {
+            qDebug()<<Q_FUNC_INFO<<"client gone, drop job "<<id;
+            return;
+        }
+        renderer.render(i);
+        const auto file = QDir(out).filePath(QString("%1.%2").arg(i).arg(format));
+        const bool jpeg = format == QLatin1StringView("jpg") || format == QLatin1StringView("jpeg");
+        const bool saved = renderer.image()
+                           && (jpeg ? JpegEncoder::save(*renderer.image(), file)
+                                    : renderer.image()->save(file, format.toLatin1().constData(), 100));
+        if (!saved) {
+            ok = false;
+            fail(QString("Save page %1 to [%2] error!").arg(i).arg(file));
+            continue;
+        }
+        ++done;
+        send(client, QJsonObject { {"id", id}, {"event", "page"}, {"page", i}, {"file", file},
+                                   {"done", done}, {"total", total} });
+    }
+    send(client, QJsonObject { {"id", id}, {"event", "finished"}, {"ok", ok},
+                               {"pages", done}, {"msecs", timer.elapsed()} });
+}
+
+void RenderDaemon::send(const ClientPtr &client, const QJsonObject &msg)
+{
+    QMetaObject::invokeMethod(this, [client, msg]() {
+        QLocalSocket *socket = client->socket;
+        if (!socket || socket->state() != QLocalSocket::ConnectedState) {
+            return;
+        }
+        socket->write(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+        socket->write("\n");
+        socket->flush();
+    }, Qt::QueuedConnection);
+}
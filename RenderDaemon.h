@@ -0,0 +1,82 @@
+#ifndef RENDERDAEMON_H
+#define RENDERDAEMON_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QPointer>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include <memory>
+
+class QLocalServer;
+class QLocalSocket;
+
+/*
+ * Long lived renderer listening on a local socket, so fonts, decoded decorations, backgrounds
+ * and parsed books stay in memory across jobs.
+ *
+ * Newline delimited json both ways. A job:
+ *   {"id": "any", "json": "<book json>", "media": "<media path>", "out": "<output path>",
+ *    "first": 0, "last": -1, "format": "jpg" | "png" | "pdf"}
+ * "first"/"last" are optional, last -1 for the last page; pdf always exports the whole book.
+ * Replies, all carrying the job id:
+ *   {"event": "accepted"}, {"event": "page", "page": n, "file": "...", "done": k, "total": t},
+ *   {"event": "finished", "ok": true, "pages": k, "msecs": ms}, {"event": "error", "message": "..."}
+ * {"cmd": "quit"} stops accepting connections and jobs, the daemon quits once the replies of the
+ * running jobs are written.
+ */
+class RenderDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RenderDaemon(QObject *parent = nullptr);
+    virtual ~RenderDaemon();
+
+    //concurrent jobs, each job renders its pages on one thread
+    void setThreadCount(int count);
+
+    bool listen(const QString &name);
+
+Q_SIGNALS:
+    void quitRequested();
+
+private:
+    //connection of a client, the socket is only touched on the daemon's thread
+    struct Client
+    {
+        QPointer<QLocalSocket> socket;
+        //set by the disconnected handler, read by the job threads
+        QAtomicInt gone;
+    };
+    using ClientPtr = std::shared_ptr<Client>;
+
+    void onNewConnection();
+    void onReadyRead(const ClientPtr &client);
+    void handleMessage(const ClientPtr &client, const QJsonObject &msg);
+
+    void runJob(const ClientPtr &client, const QJsonObject &job);
+
+    //on the daemon's thread after the last reply of a job
+    void onJobDone();
+
+    //emits quitRequested once quit is asked, no job runs and all replies are written
+    void quitIfDone();
+
+    //queued to the daemon's thread, dropped if the client is gone
+    void send(const ClientPtr &client, const QJsonObject &msg);
+
+private:
+    QLocalServer *m_server = nullptr;
+    QThreadPool m_pool;
+    //set on destruction, running jobs give up
+    QAtomicInt m_stopping;
+    QHash<QLocalSocket*, ClientPtr> m_clients;
+    //on the daemon's thread only
+    int m_jobs = 0;
+    bool m_quitting = false;
+    bool m_quitEmitted = false;
+};
+
+#endif // RENDERDAEMON_H
@@ -0,0 +1,363 @@
+#include "Resampler.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QtMath>
+
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "PixelFormatPolicy.h"
+
+//Lanczos-3, support in source pixels at scale 1
+const static double LANCZOS_SUPPORT = 3.0;
+
+//box filter only down to twice the target, the lanczos pass does the rest
+const static int BOX_MIN_RATIO = 2;
+
+//rows per task, and images smaller than this many pixels stay on the calling thread
+const static int ROWS_PER_TASK = 32;
+const static qint64 PARALLEL_MIN_PIXELS = 512 * 512;
+
+static thread_local bool s_fastMode = false;
+
+namespace {
+
+QThreadPool *resamplePool()
+{
+    static QThreadPool *pool = []() {
+        auto *p = new QThreadPool;
+        p->setMaxThreadCount(QThread::idealThreadCount());
+        return p;
+    }();
+    return pool;
+}
+
+struct ParallelJob
+{
+    std::function<void(int)> fn;
+    int count = 0;
+    std::atomic<int> next {0};
+    std::atomic<int> done {0};
+    QMutex mutex;
+    QWaitCondition finished;
+
+    void run()
+    {
+        for (int i = next++; i < count; i = next++) {
+            fn(i);
+            if (++done == count) {
+                QMutexLocker locker(&mutex);
+                finished.wakeAll();
+            }
+        }
+    }
+};
+
+/*
+ * Runs fn(0..count-1) on the pool and the calling thread.
+ * The caller takes tasks too, so it never waits on a busy pool (e.g. under the batch renderer),
+ * late pool tasks find nothing left and return.
+ */
+void parallelFor(int count, qint64 pixels, const std::function<void(int)> &fn)
+{
+    if (count <= 1 || pixels < PARALLEL_MIN_PIXELS) {
+        for (int i=0; i<count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    auto job = std::make_shared<ParallelJob>();
+    job->fn = fn;
+    job->count = count;
+    const int helpers = qMin(count, resamplePool()->maxThreadCount()) - 1;
+    for (int i=0; i<helpers; ++i) {
+        resamplePool()->start([job]() {
+            job->run();
+        });
+    }
+    job->run();
+    QMutexLocker locker(&job->mutex);
+    while (job->done.load() < count) {
+        job->finished.wait(&job->mutex);
+    }
+}
+
+double lanczos3(double x)
+{
+    x = std::abs(x);
+    if (x < 1e-8) {
+        return 1.0;
+    }
+    if (x >= LANCZOS_SUPPORT) {
+        return 0.0;
+    }
+    const double px = M_PI * x;
+    return LANCZOS_SUPPORT * std::sin(px) * std::sin(px / LANCZOS_SUPPORT) / (px * px);
+}
+
+//normalized filter taps of every output pixel along one axis
+struct Contributions
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;
+    int taps = 0;
+};
+
+Contributions contributions(int inSize, int outSize)
+{
+    const double scale = static_cast<double>(inSize) / outSize;
+    const double filterScale = qMax(1.0, scale);
+    const double support = LANCZOS_SUPPORT * filterScale;
+
+    Contributions c;
+    c.taps = static_cast<int>(std::ceil(support)) * 2 + 2;
+    c.first.resize(outSize);
+    c.count.resize(outSize);
+    c.weights.assign(static_cast<size_t>(outSize) * c.taps, 0.0f);
+
+    for (int i=0; i<outSize; ++i) {
+        const double center = (i + 0.5) * scale;
+        const int lo = qMax(0, static_cast<int>(std::floor(center - support)));
+        const int hi = qMin(inSize, static_cast<int>(std::ceil(center + support)));
+        const int n = qMin(hi - lo, c.taps);
+        float *w = &c.weights[static_cast<size_t>(i) * c.taps];
+        double sum = 0;
+        for (int k=0; k<n; ++k) {
+            const double v = lanczos3((lo + k + 0.5 - center) / filterScale);
+            w[k] = static_cast<float>(v);
+            sum += v;
+        }
+        if (sum != 0) {
+            for (int k=0; k<n; ++k) {
+                w[k] = static_cast<float>(w[k] / sum);
+            }
+        }
+        c.first[i] = lo;
+        c.count[i] = n;
+    }
+    return c;
+}
+
+inline uint clampChannel(float v)
+{
+    return v <= 0.0f ? 0u : (v >= 255.0f ? 255u : static_cast<uint>(v + 0.5f));
+}
+
+//same layout for RGB32 and ARGB32_Premultiplied, opaque forces alpha, premultiplied keeps color <= alpha
+inline QRgb pack(const float acc[4], bool opaque)
+{
+    const uint a = opaque ? 255u : clampChannel(acc[0]);
+    const uint r = qMin(a, clampChannel(acc[1]));
+    const uint g = qMin(a, clampChannel(acc[2]));
+    const uint b = qMin(a, clampChannel(acc[3]));
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+//kernels are plain float loops over 4 channels, left to the compiler's auto vectorizer
+inline void accumulate(float acc[4], QRgb p, float w)
+{
+    acc[0] += w * qAlpha(p);
+    acc[1] += w * qRed(p);
+    acc[2] += w * qGreen(p);
+    acc[3] += w * qBlue(p);
+}
+
+} //namespace
+
+Resampler::FastScope::FastScope()
+    : m_previous(s_fastMode)
+{
+    s_fastMode = true;
+}
+
+Resampler::FastScope::~FastScope()
+{
+    s_fastMode = m_previous;
+}
+
+bool Resampler::fastMode()
+{
+    return s_fastMode;
+}
+
+QImage Resampler::scaled(const QImage &img, const QSize &size, Qt::AspectRatioMode mode)
+{
+    if (img.isNull()) {
+        return QImage();
+    }
+    const QSize target = img.size().scaled(size, mode);
+    if (target.isEmpty()) {
+        return QImage();
+    }
+    QImage src = img;
+    PixelFormatPolicy().normalize(src);
+    if (target == src.size()) {
+        return src;
+    }
+    if (s_fastMode) {
+        return src.scaled(target, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+
+    const int fx = src.width() / (target.width() * BOX_MIN_RATIO);
+    const int fy = src.height() / (target.height() * BOX_MIN_RATIO);
+    if (fx > 1 || fy > 1) {
+        src = boxReduce(src, qMax(1, fx), qMax(1, fy));
+    }
+    return lanczos(src, target);
+}
+
+QImage Resampler::scaled(const QImage &img, int width, int height, Qt::AspectRatioMode mode)
+{
+    return scaled(img, QSize(width, height), mode);
+}
+
+QImage Resampler::scaledToWidth(const QImage &img, int width)
+{
+    if (img.isNull() || width <= 0) {
+        return QImage();
+    }
+    const qreal factor = static_cast<qreal>(width) / img.width();
+    return scaled(img, QSize(width, qMax(1, qRound(img.height() * factor))));
+}
+
+QImage Resampler::scaledToHeight(const QImage &img, int height)
+{
+    if (img.isNull() || height <= 0) {
+        return QImage();
+    }
+    const qreal factor = static_cast<qreal>(height) / img.height();
+    return scaled(img, QSize(qMax(1, qRound(img.width() * factor)), height));
+}
+
+QImage Resampler::boxReduce(const QImage &src, int fx, int fy)
+{
+    const int w = src.width() / fx;
+    const int h = src.height() / fy;
+    QImage dst(w, h, src.format());
+    if (dst.isNull()) {
+        return src;
+    }
+    const bool opaque = src.format() == QImage::Format_RGB32;
+    const float inv = 1.0f / (fx * fy);
+    const int tasks = (h + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+
+    parallelFor(tasks, static_cast<qint64>(src.width()) * src.height(), [&](int t) {
+        const int y0 = t * ROWS_PER_TASK;
+        const int y1 = qMin(h, y0 + ROWS_PER_TASK);
+        for (int y=y0; y<y1; ++y) {
+            auto *out = reinterpret_cast<QRgb *>(dst.scanLine(y));
+            for (int x=0; x<w; ++x) {
+                float acc[4] = {0, 0, 0, 0};
+                for (int j=0; j<fy; ++j) {
+                    const auto *in = reinterpret_cast<const QRgb *>(src.constScanLine(y * fy + j)) + x * fx;
+                    for (int i=0; i<fx; ++i) {
+                        accumulate(acc, in[i], 1.0f);
+                    }
+                }
+                for (float &v : acc) {
+                    v *= inv;
+                }
+                out[x] = pack(acc, opaque);
+            }
+        }
+    });
+    return dst;
+}
+
+QImage Resampler::lanczos(const QImage &src, const QSize &size)
+{
+    const bool opaque = src.format() == QImage::Format_RGB32;
+    const int outW = size.width();
+    const int outH = size.height();
+    const auto cx = contributions(src.width(), outW);
+    const auto cy = contributions(src.height(), outH);
+
+    //horizontal pass into an 8 bit intermediate of outW x src height
+    QImage tmp(outW, src.height(), src.format());
+    QImage dst(outW, outH, src.format());
+    if (tmp.isNull() || dst.isNull()) {
+        return src.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    const qint64 pixels = static_cast<qint64>(src.width()) * src.height();
+
+    parallelFor((src.height() + ROWS_PER_TASK - 1) / ROWS_PER_TASK, pixels, [&](int t) {
+        const int y0 = t * ROWS_PER_TASK;
+        const int y1 = qMin(src.height(), y0 + ROWS_PER_TASK);
+        for (int y=y0; y<y1; ++y) {
+            const auto *in = reinterpret_cast<const QRgb *>(src.constScanLine(y));
+            auto *out = reinterpret_cast<QRgb *>(tmp.scanLine(y));
+            for (int x=0; x<outW; ++x) {
+                const float *w = &cx.weights[static_cast<size_t>(x) * cx.taps];
+                const QRgb *p = in + cx.first[x];
+                float acc[4] = {0, 0, 0, 0};
+                for (int k=0; k<cx.count[x]; ++k) {
+                    accumulate(acc, p[k], w[k]);
+                }
+                out[x] = pack(acc, opaque);
+            }
+        }
+    });
+
+    parallelFor((outH + ROWS_PER_TASK - 1) / ROWS_PER_TASK, pixels, [&](int t) {
+        const int y0 = t * ROWS_PER_TASK;
+        const int y1 = qMin(outH, y0 + ROWS_PER_TASK);
+        std::vector<float> acc(static_cast<size_t>(outW) * 4);
+        for (int y=y0; y<y1; ++y) {
+            //row by row over the taps, so every input row is read sequentially
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            const float *w = &cy.weights[static_cast<size_t>(y) * cy.taps];
+            for (int k=0; k<cy.count[y]; ++k) {
+                const auto *in = reinterpret_cast<const QRgb *>(tmp.constScanLine(cy.first[y] + k));
+                for (int x=0; x<outW; ++x) {
+                    accumulate(&acc[static_cast<size_t>(x) * 4], in[x], w[k]);
+                }
+            }
+            auto *out = reinterpret_cast<QRgb *>(dst.scanLine(y));
+            for (int x=0; x<outW; ++x) {
+                out[x] = pack(&acc[static_cast<size_t>(x) * 4], opaque);
+            }
+        }
+    });
+    return dst;
+}
+
+void Resampler::benchmark(const QImage &img, int rounds)
+{
+    QImage src = img;
+    PixelFormatPolicy().normalize(src);
+    rounds = qMax(1, rounds);
+    qInfo()<<"resample "<<src.size()<<", "<<rounds<<" rounds, "<<resamplePool()->maxThreadCount()<<" threads";
+
+    for (const int div : {2, 4, 8, 16}) {
+        const QSize target(qMax(1, src.width() / div), qMax(1, src.height() / div));
+        QElapsedTimer timer;
+
+        timer.start();
+        for (int i=0; i<rounds; ++i) {
+            const auto out = src.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            Q_UNUSED(out)
+        }
+        const qint64 qtMs = timer.elapsed();
+
+        timer.restart();
+        for (int i=0; i<rounds; ++i) {
+            const auto out = scaled(src, target);
+            Q_UNUSED(out)
+        }
+        const qint64 ownMs = timer.elapsed();
+
+        qInfo()<<"  1/"<<div<<" "<<target<<": QImage::scaled "<<qtMs / static_cast<double>(rounds)<<" ms"
+                <<", Resampler "<<ownMs / static_cast<double>(rounds)<<" ms"
+                <<", x"<<qtMs / qMax<double>(1, ownMs);
+    }
+}
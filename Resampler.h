@@ -0,0 +1,50 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QImage>
+#include <QSize>
+
+/*
+ * Smooth image scaling for large downscale ratios, replaces QImage::scaled(..., Qt::SmoothTransformation).
+ * Large ratios are first reduced by an integer box filter, then one separable Lanczos-3 pass
+ * produces the final size. Rows are split across a thread pool for large images.
+ * Works on RGB32 / ARGB32_Premultiplied, other formats are converted with PixelFormatPolicy first.
+ */
+class Resampler
+{
+public:
+    //while alive, scaling on the calling thread uses Qt::FastTransformation, for draft renders
+    class FastScope
+    {
+    public:
+        FastScope();
+        ~FastScope();
+
+    private:
+        Q_DISABLE_COPY(FastScope)
+        bool m_previous;
+    };
+
+    static bool fastMode();
+
+    static QImage scaled(const QImage &img, const QSize &size,
+                         Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio);
+
+    static QImage scaled(const QImage &img, int width, int height,
+                         Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio);
+
+    static QImage scaledToWidth(const QImage &img, int width);
+
+    static QImage scaledToHeight(const QImage &img, int height);
+
+    //print timings of QImage::scaled and Resampler for some target widths
+    static void benchmark(const QImage &img, int rounds);
+
+private:
+    //integer box filter, src size is divided by fx and fy
+    static QImage boxReduce(const QImage &src, int fx, int fy);
+
+    static QImage lanczos(const QImage &src, const QSize &size);
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,149 @@
+#include "ThumbnailProvider.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+//TODO magic size, enough to show a strip without scaling the thumbnails again
+const static int THUMB_DEFAULT_WIDTH = 120;
+
+//in bytes, about 1000 thumbnails of 120x170 RGB32
+const static qsizetype THUMB_CACHE_MAX_COST = 80 * 1024 * 1024;
+
+ThumbnailProvider::ThumbnailProvider(QObject *parent)
+    : QObject(parent)
+    , m_thumbWidth(THUMB_DEFAULT_WIDTH)
+{
+    //leave a core to the GUI thread and the full page preview
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_cache.setMaxCost(THUMB_CACHE_MAX_COST);
+}
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void ThumbnailProvider::setThumbnailWidth(int width)
+{
+    m_thumbWidth = width > 0 ? width : THUMB_DEFAULT_WIDTH;
+}
+
+int ThumbnailProvider::thumbnailWidth() const
+{
+    return m_thumbWidth;
+}
+
+void ThumbnailProvider::start(const BookData &book)
+{
+    cancel();
+    m_cache.clear();
+
+    m_book = book;
+    m_pageCount = book.pages.size();
+    if (m_pageCount == 0 || book.pageSize.PageWidth <= 0) {
+        m_pageCount = 0;
+        return;
+    }
+    m_scale = static_cast<qreal>(m_thumbWidth) / book.pageSize.PageWidth;
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_queue.clear();
+        m_queue.reserve(m_pageCount);
+        for (int i=0; i<m_pageCount; ++i) {
+            m_queue.append(i);
+        }
+    }
+
+    const int generation = m_generation.loadAcquire();
+    const int threads = qMin(m_pool.maxThreadCount(), m_pageCount);
+    for (int i=0; i<threads; ++i) {
+        startWorker(generation);
+    }
+}
+
+void ThumbnailProvider::cancel()
+{
+    m_generation.fetchAndAddOrdered(1);
+    QMutexLocker locker(&m_queueMutex);
+    m_queue.clear();
+}
+
+QImage ThumbnailProvider::thumbnail(int pgNum)
+{
+    if (auto *cached = m_cache.object(pgNum)) {
+        return *cached;
+    }
+    request(pgNum);
+    return QImage();
+}
+
+void ThumbnailProvider::request(int pgNum)
+{
+    if (pgNum < 0 || pgNum >= m_pageCount) {
+        return;
+    }
+    bool idle = false;
+    {
+        QMutexLocker locker(&m_queueMutex);
+        idle = m_queue.isEmpty();
+        //evicted thumbnails are queued again, queued ones move to the front
+        m_queue.removeOne(pgNum);
+        m_queue.prepend(pgNum);
+    }
+    //workers quit once the queue was drained
+    if (idle) {
+        startWorker(m_generation.loadAcquire());
+    }
+}
+
+void ThumbnailProvider::startWorker(int generation)
+{
+    m_pool.start([this, generation, book = m_book, scale = m_scale]() {
+        runWorker(generation, book, scale);
+    });
+}
+
+void ThumbnailProvider::runWorker(int generation, const BookData &book, qreal scale)
+{
+    BookRenderer renderer;
+    renderer.setBook(book);
+
+    QElapsedTimer timer;
+    timer.start();
+    int count = 0;
+
+    int pgNum = -1;
+    while (takePage(generation, pgNum)) {
+        const QImage img = renderer.renderThumbnail(pgNum, scale);
+        ++count;
+        QMetaObject::invokeMethod(this, [this, generation, pgNum, img]() {
+            deliver(generation, pgNum, img);
+        }, Qt::QueuedConnection);
+    }
+    qDebug()<<Q_FUNC_INFO<<"rendered "<<count<<" thumbnails in "<<timer.elapsed()<<" ms";
+}
+
+bool ThumbnailProvider::takePage(int generation, int &pgNum)
+{
+    if (generation != m_generation.loadAcquire()) {
+        return false;
+    }
+    QMutexLocker locker(&m_queueMutex);
+    if (m_queue.isEmpty()) {
+        return false;
+    }
+    pgNum = m_queue.takeFirst();
+    return true;
+}
+
+void ThumbnailProvider::deliver(int generation, int pgNum, const QImage &image)
+{
+    if (generation != m_generation.loadAcquire() || image.isNull()) {
+        return;
+    }
+    m_cache.insert(pgNum, new QImage(image), image.sizeInBytes());
+    Q_EMIT thumbnailReady(pgNum, image);
+}
@@ -0,0 +1,68 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThreadPool>
+
+#include "BookRenderer.h"
+
+/*
+ * Low resolution page thumbnails of a whole book, rendered in the background
+ * through a scaled painter by one renderer per pool thread.
+ * Pages are rendered in order, requested pages jump the queue.
+ * Lives on the GUI thread, thumbnailReady is always emitted there.
+ */
+class ThumbnailProvider : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailProvider(QObject *parent = nullptr);
+    virtual ~ThumbnailProvider();
+
+    //thumbnails are this wide, height keeps the page ratio
+    void setThumbnailWidth(int width);
+    int thumbnailWidth() const;
+
+    //drop the old book and start rendering thumbnails of the new one
+    void start(const BookData &book);
+
+    void cancel();
+
+    //cached thumbnail, or a null image and the page is queued first
+    QImage thumbnail(int pgNum);
+
+    void request(int pgNum);
+
+Q_SIGNALS:
+    void thumbnailReady(int pgNum, const QImage &image);
+
+private:
+    void startWorker(int generation);
+    void runWorker(int generation, const BookData &book, qreal scale);
+    bool takePage(int generation, int &pgNum);
+    void deliver(int generation, int pgNum, const QImage &image);
+
+private:
+    int m_thumbWidth = 0;
+    int m_pageCount = 0;
+    qreal m_scale = 0;
+    BookData m_book;
+
+    QThreadPool m_pool;
+
+    //bumped by start() and cancel(), workers of an older generation quit
+    QAtomicInt m_generation;
+
+    QMutex m_queueMutex;
+    QList<int> m_queue;
+
+    //only touched on the GUI thread
+    QCache<int, QImage> m_cache;
+};
+
+#endif // THUMBNAILPROVIDER_H
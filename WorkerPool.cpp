@@ -0,0 +1,368 @@
+#include "WorkerPool.h"
+
+#include <QDebug>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QThread>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <cstdio>
+
+#include "BookJson.h"
+#include "BookRenderer.h"
+#include "JpegEncoder.h"
+
+//TODO magic numbers, a page renders in well under a second
+const static int PAGES_PER_TASK_DEFAULT = 8;
+const static int TASK_TIMEOUT_PER_PAGE_MS = 30 * 1000;
+const static int TASK_MAX_ATTEMPTS = 2;
+
+WorkerPool::WorkerPool(QObject *parent)
+    : QObject(parent)
+    , m_processCount(QThread::idealThreadCount())
+    , m_pagesPerTask(PAGES_PER_TASK_DEFAULT)
+{
+
+}
+
+WorkerPool::~WorkerPool()
+{
+    cancel();
+}
+
+void WorkerPool::setProcessCount(int count)
+{
+    m_processCount = count > 0 ? count : QThread::idealThreadCount();
+}
+
+int WorkerPool::processCount() const
+{
+    return m_processCount;
+}
+
+void WorkerPool::setWorkerArguments(const QStringList &args)
+{
+    m_workerArgs = args;
+}
+
+void WorkerPool::setPagesPerTask(int pages)
+{
+    m_pagesPerTask = pages > 0 ? pages : PAGES_PER_TASK_DEFAULT;
+}
+
+bool WorkerPool::start(const QList<BatchBook> &books)
+{
+    if (m_running) {
+        qDebug()<<Q_FUNC_INFO<<"pool is running";
+        return false;
+    }
+    m_books = books;
+    m_tasks.clear();
+    m_failedBooks.clear();
+    m_bookLeft.fill(0, books.size());
+    m_bookTimer.resize(books.size());
+    m_done = 0;
+    m_total = 0;
+
+    //page counts come from the (binary cached) json, nothing is rendered in this process
+    for (int i=0; i<books.size(); ++i) {
+        QString error;
+        const int pages = BookJson::loadData(books.at(i).jsonPath, &error).value("Pages").toArray().size();
+        if (pages == 0) {
+            m_failedBooks.insert(i);
+            Q_EMIT bookError(i, QString("Load book [%1] error! %2").arg(books.at(i).jsonPath, error));
+            continue;
+        }
+        for (int first=0; first<pages; first+=m_pagesPerTask) {
+            m_tasks.push_back(Task{i, first, qMin(pages, first + m_pagesPerTask) - 1, 0});
+        }
+        m_bookLeft[i] = pages;
+        m_total += pages;
+        m_bookTimer[i].start();
+    }
+    if (m_tasks.empty()) {
+        qDebug()<<Q_FUNC_INFO<<"no page to render";
+        return false;
+    }
+
+    m_running = true;
+    m_timer.start();
+    const int count = qMin<int>(m_processCount, static_cast<int>(m_tasks.size()));
+    m_workers.clear();
+    for (int i=0; i<count; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+        spawn(i);
+    }
+    qDebug()<<Q_FUNC_INFO<<"render "<<m_total<<" pages of "<<books.size()<<" books in "<<count<<" processes";
+    dispatch();
+    return true;
+}
+
+void WorkerPool::cancel()
+{
+    m_tasks.clear();
+    for (const auto &w : m_workers) {
+        if (w->process) {
+            w->process->disconnect(this);
+            w->process->kill();
+            w->process->waitForFinished();
+            delete w->process;
+            w->process = nullptr;
+        }
+        delete w->timer;
+        w->timer = nullptr;
+    }
+    m_workers.clear();
+    m_running = false;
+}
+
+bool WorkerPool::isRunning() const
+{
+    return m_running;
+}
+
+void WorkerPool::spawn(int worker)
+{
+    auto &w = m_workers.at(worker);
+    if (!w->timer) {
+        w->timer = new QTimer;
+        w->timer->setSingleShot(true);
+        connect(w->timer, &QTimer::timeout,
+                this, [this, worker]() {
+            onWorkerDied(worker, "timeout");
+        });
+    }
+    w->busy = false;
+    w->buffer.clear();
+    w->process = new QProcess;
+    //worker logs go to our stderr
+    w->process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(w->process, &QProcess::readyReadStandardOutput,
+            this, [this, worker]() {
+        onOutput(worker);
+    });
+    connect(w->process, &QProcess::finished,
+            this, [this, worker](int exitCode, QProcess::ExitStatus status) {
+        onWorkerDied(worker, status == QProcess::CrashExit ? QString("crashed")
+                                                           : QString("exited with %1").arg(exitCode));
+    });
+    //workers render and encode pages like this process
+    w->process->start(QCoreApplication::applicationFilePath(),
+                      QStringList() << "--worker" << m_workerArgs);
+    if (!w->process->waitForStarted()) {
+        qWarning()<<Q_FUNC_INFO<<"start worker "<<worker<<" error "<<w->process->errorString();
+        w->process->disconnect(this);
+        delete w->process;
+        w->process = nullptr;
+    }
+}
+
+void WorkerPool::dispatch()
+{
+    for (int i=0; i<static_cast<int>(m_workers.size()) && !m_tasks.empty(); ++i) {
+        auto &w = m_workers.at(i);
+        if (w->busy || !w->process) {
+            continue;
+        }
+        auto task = m_tasks.front();
+        m_tasks.pop_front();
+        if (m_failedBooks.contains(task.book)) {
+            --i;
+            continue;
+        }
+        const auto &book = m_books.at(task.book);
+        const QJsonObject msg {
+            {"json",  book.jsonPath},
+            {"media", book.mediaPath},
+            {"out",   book.outPath},
+            {"first", task.first},
+            {"last",  task.last},
+        };
+        task.attempts++;
+        w->task = task;
+        w->busy = true;
+        w->process->write(QJsonDocument(msg).toJson(QJsonDocument::Compact) + "\n");
+        w->timer->start(TASK_TIMEOUT_PER_PAGE_MS * (task.last - task.first + 1));
+    }
+    checkFinished();
+}
+
+void WorkerPool::onOutput(int worker)
+{
+    auto &w = m_workers.at(worker);
+    w->buffer.append(w->process->readAllStandardOutput());
+    for (int idx = w->buffer.indexOf('\n'); idx >= 0; idx = w->buffer.indexOf('\n')) {
+        const QByteArray line = w->buffer.left(idx);
+        w->buffer.remove(0, idx + 1);
+        const auto reply = QJsonDocument::fromJson(line).object();
+        if (reply.isEmpty() || !w->busy) {
+            continue;
+        }
+        JpegEncoder::addToSummary(JpegSummary::fromJson(reply.value("jpeg").toObject()));
+        onTaskDone(worker, reply.value("ok").toBool(), reply.value("pages").toInt(), reply.value("message").toString());
+    }
+}
+
+void WorkerPool::onTaskDone(int worker, bool ok, int pages, const QString &msg)
+{
+    auto &w = m_workers.at(worker);
+    w->timer->stop();
+    w->busy = false;
+    const auto task = w->task;
+    //late range of a book dropped by another worker
+    if (m_failedBooks.contains(task.book)) {
+        dispatch();
+        return;
+    }
+    if (!ok) {
+        Q_EMIT bookError(task.book, QString("Pages %1-%2 of [%3]: %4")
+                                        .arg(task.first)
+                                        .arg(task.last)
+                                        .arg(m_books.at(task.book).jsonPath, msg));
+    }
+    //pages of a range are counted done even if some failed, only crashed or stuck ranges are retried
+    const int rangePages = task.last - task.first + 1;
+    if (pages != rangePages) {
+        qDebug()<<Q_FUNC_INFO<<"saved "<<pages<<" of "<<rangePages<<" pages";
+    }
+    m_done += rangePages;
+    m_bookLeft[task.book] -= rangePages;
+    if (m_bookLeft.at(task.book) == 0 && !m_failedBooks.contains(task.book)) {
+        Q_EMIT bookFinished(task.book, m_bookTimer.at(task.book).elapsed());
+    }
+    Q_EMIT progress(m_done, m_total, m_done * 1000.0 / qMax<qint64>(1, m_timer.elapsed()));
+    dispatch();
+}
+
+void WorkerPool::onWorkerDied(int worker, const QString &reason)
+{
+    auto &w = m_workers.at(worker);
+    w->timer->stop();
+    if (w->process) {
+        w->process->disconnect(this);
+        w->process->kill();
+        w->process->waitForFinished();
+        w->process->deleteLater();
+        w->process = nullptr;
+    }
+    if (w->busy) {
+        auto task = w->task;
+        w->busy = false;
+        qWarning()<<Q_FUNC_INFO<<"worker "<<worker<<" "<<reason<<" on pages "<<task.first<<"-"<<task.last
+                  <<" of "<<m_books.at(task.book).jsonPath;
+        if (task.attempts < TASK_MAX_ATTEMPTS) {
+            m_tasks.push_front(task);
+        } else {
+            //poisoned book, drop the rest of it so it can't take down more workers
+            m_failedBooks.insert(task.book);
+            Q_EMIT bookError(task.book, QString("Worker %1 on pages %2-%3 of [%4], book dropped")
+                                            .arg(reason)
+                                            .arg(task.first)
+                                            .arg(task.last)
+                                            .arg(m_books.at(task.book).jsonPath));
+            m_done += m_bookLeft.at(task.book);
+            m_bookLeft[task.book] = 0;
+        }
+    }
+    if (m_running && !m_tasks.empty()) {
+        spawn(worker);
+    }
+    dispatch();
+}
+
+void WorkerPool::checkFinished()
+{
+    if (!m_running) {
+        return;
+    }
+    bool alive = false;
+    for (const auto &w : m_workers) {
+        if (w->busy) {
+            return;
+        }
+        alive = alive || w->process;
+    }
+    if (!m_tasks.empty()) {
+        if (alive) {
+            return;
+        }
+        //no worker could be started, nothing will take the rest
+        qWarning()<<Q_FUNC_INFO<<"no worker left, drop "<<m_tasks.size()<<" tasks";
+        for (const auto &t : m_tasks) {
+            if (!m_failedBooks.contains(t.book)) {
+                m_failedBooks.insert(t.book);
+                Q_EMIT bookError(t.book, QString("No worker to render [%1]!").arg(m_books.at(t.book).jsonPath));
+            }
+        }
+        m_tasks.clear();
+    }
+    for (const auto &w : m_workers) {
+        if (w->process) {
+            //closing stdin ends the worker loop
+            w->process->disconnect(this);
+            w->process->closeWriteChannel();
+            w->process->waitForFinished();
+            w->process->deleteLater();
+            w->process = nullptr;
+        }
+    }
+    m_running = false;
+    Q_EMIT finished(m_done, m_timer.elapsed());
+}
+
+int WorkerPool::runWorker()
+{
+    QFile in;
+    QFile out;
+    if (!in.open(stdin, QIODevice::ReadOnly) || !out.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+    //kept across tasks, consecutive ranges of a book are usually sent to the same worker
+    BookRenderer renderer;
+    QString curJson;
+
+    while (true) {
+        const QByteArray line = in.readLine();
+        if (line.isEmpty()) {
+            break;
+        }
+        const auto task = QJsonDocument::fromJson(line).object();
+        const auto json = task.value("json").toString();
+        const auto outPath = task.value("out").toString();
+
+        QJsonObject reply { {"ok", true} };
+        int pages = 0;
+        //summary of this task only, the pool adds it to its own
+        JpegEncoder::resetSummary();
+        if (json != curJson) {
+            curJson.clear();
+            if (renderer.load(json, task.value("media").toString())) {
+                curJson = json;
+            }
+        }
+        if (curJson.isEmpty() || !QDir().mkpath(outPath)) {
+            reply.insert("ok", false);
+            reply.insert("message", QString("Load book [%1] error!").arg(json));
+        } else {
+            const int last = qMin(task.value("last").toInt(), renderer.pageCount() - 1);
+            for (int i=task.value("first").toInt(); i<=last; ++i) {
+                if (renderer.save(i, outPath)) {
+                    ++pages;
+                } else {
+                    reply.insert("ok", false);
+                    reply.insert("message", QString("Save page %1 error!").arg(i));
+                }
+            }
+        }
+        reply.insert("pages", pages);
+        reply.insert("jpeg", JpegEncoder::summary().toJson());
+        out.write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + "\n");
+        out.flush();
+    }
+    return 0;
+}
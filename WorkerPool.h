@@ -0,0 +1,103 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "BatchScheduler.h"
+
+class QProcess;
+class QTimer;
+
+/*
+ * Renders a class of books in worker processes instead of threads, so a book that crashes
+ * or hangs the renderer only costs its worker. Every worker is this executable started with
+ * --worker, it gets one page range per line of json on stdin and answers one line on stdout.
+ * Stuck ranges are killed after a timeout, dead workers are restarted, a range that fails
+ * twice marks its book as failed and the rest of the class goes on.
+ */
+class WorkerPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WorkerPool(QObject *parent = nullptr);
+    virtual ~WorkerPool();
+
+    void setProcessCount(int count);
+
+    int processCount() const;
+
+    //options of this process that change how pages render, passed to every worker after --worker
+    void setWorkerArguments(const QStringList &args);
+
+    //pages per task, smaller ranges balance better, larger ones reload books less often
+    void setPagesPerTask(int pages);
+
+    bool start(const QList<BatchBook> &books);
+
+    void cancel();
+
+    bool isRunning() const;
+
+    //worker side, serves tasks from stdin until it's closed, returns the exit code
+    static int runWorker();
+
+Q_SIGNALS:
+    void bookError(int book, const QString &msg);
+    void bookFinished(int book, qint64 msecs);
+    void progress(int done, int total, double pagesPerSecond);
+    void finished(int pages, qint64 msecs);
+
+private:
+    struct Task
+    {
+        int book = -1;
+        int first = 0;
+        int last = -1;
+        int attempts = 0;
+    };
+
+    struct Worker
+    {
+        QProcess *process = nullptr;
+        QTimer *timer = nullptr;
+        //valid while a task is running
+        bool busy = false;
+        Task task;
+        QByteArray buffer;
+    };
+
+    void spawn(int worker);
+    void dispatch();
+    void onOutput(int worker);
+    void onTaskDone(int worker, bool ok, int pages, const QString &msg);
+    void onWorkerDied(int worker, const QString &reason);
+    void checkFinished();
+
+private:
+    int m_processCount = 0;
+    int m_pagesPerTask = 0;
+    QStringList m_workerArgs;
+    bool m_running = false;
+
+    QList<BatchBook> m_books;
+    std::deque<Task> m_tasks;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    QList<int> m_bookLeft;
+    QList<QElapsedTimer> m_bookTimer;
+    QSet<int> m_failedBooks;
+
+    int m_done = 0;
+    int m_total = 0;
+    QElapsedTimer m_timer;
+};
+
+#endif // WORKERPOOL_H
@@ -1,6 +0,0 @@
-#ifndef YQZDGLOBAL_H
-#define YQZDGLOBAL_H
-
-#define MEDIA_PATH_SEPARATE_BY_ID 0
-
-#endif // YQZDGLOBAL_H
@@ -1,31 +1,301 @@
 #include "MainWindow.h"
 
 #include <QApplication>
-#include <QFontDatabase>
+#include <QCommandLineParser>
 #include <QDebug>
 
+#include "BatchScheduler.h"
+#include "BookJson.h"
+#include "FontRegistry.h"
+#include "Resampler.h"
+#include "MemoryBudget.h"
+#include "RenderDaemon.h"
+#include "WorkerPool.h"
+#include "MediaLayout.h"
+#include "MediaPack.h"
+#include "JpegEncoder.h"
+#include "MediaPipeline.h"
+
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
-    {
-        const auto id = QFontDatabase::addApplicationFont(":/yahei.ttf");
-        const auto fonts = QFontDatabase::applicationFontFamilies(id);
-        qDebug()<<"fonts: "<<fonts;
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption batchOpt("batch",
+                                      "Render json file or directory of json files without window, can be repeated.",
+                                      "path");
+    const QCommandLineOption outOpt("out",
+                                    "Output root of batch mode, media and images in <out>/<book name>.",
+                                    "path");
+    const QCommandLineOption threadsOpt("threads",
+                                        "Render threads of batch mode.",
+                                        "count");
+    const QCommandLineOption downloadOpt("download",
+                                         "Download the media of every batch book before rendering it, "
+                                         "downloads of some books overlap the rendering of others.");
+    const QCommandLineOption noCacheOpt("no-book-cache",
+                                        "Always parse the json, don't read or write <json>.bookcache.");
+    const QCommandLineOption fontDirOpt("font-dir",
+                                        "Load fonts from path instead of the resources, fonts are registered on first use.",
+                                        "path");
+    const QCommandLineOption benchResampleOpt("bench-resample",
+                                              "Compare QImage::scaled and the resampler on an image, then quit.",
+                                              "image");
+    const QCommandLineOption memoryOpt("memory-budget",
+                                       "Image memory of all renders in MB, renders wait or caches are dropped above it, 0 for no limit.",
+                                       "MB");
+    const QCommandLineOption daemonOpt("daemon",
+                                       "Serve render jobs on local socket name without window, see RenderDaemon.",
+                                       "name");
+    const QCommandLineOption processesOpt("processes",
+                                          "Render batch mode in count worker processes instead of threads, "
+                                          "a crashing book only takes its worker down.",
+                                          "count");
+    const QCommandLineOption layoutOpt("media-layout",
+                                       "Directory layout of new media paths: flat, id (per page) or hash (ab/cd/ prefixes).",
+                                       "scheme");
+    const QCommandLineOption migrateOpt("migrate-media",
+                                        "Move the media of path to the --media-layout scheme, then quit.",
+                                        "path");
+    const QCommandLineOption migrateBookOpt("migrate-book",
+                                            "Book json of --migrate-media, needed for the id layout.",
+                                            "json");
+    const QCommandLineOption writePackOpt("write-media-pack",
+                                          "Pack the media path into <media>/media.pack after every download.");
+    const QCommandLineOption packOpt("pack-media",
+                                     "Pack the downloaded media of path into <path>/media.pack, then quit.",
+                                     "path");
+    const QCommandLineOption jpegQualityOpt("jpeg-quality",
+                                            "Jpeg quality of the pages, the upper bound of --jpeg-max-kb and --jpeg-psnr, default 100.",
+                                            "quality");
+    const QCommandLineOption jpegMaxOpt("jpeg-max-kb",
+                                        "Largest page file, the highest quality that fits is searched per page.",
+                                        "KB");
+    const QCommandLineOption jpegPsnrOpt("jpeg-psnr",
+                                         "Lowest quality per page that keeps this PSNR to the rendered page, e.g. 40.",
+                                         "dB");
+    const QCommandLineOption jpegProgressiveOpt("jpeg-progressive",
+                                                "Write progressive jpeg pages.");
+    const QCommandLineOption pipelineOpt("pipeline",
+                                         "Download, validate and render json file or directory of json files "
+                                         "without window as one coroutine pipeline per book, can be repeated.",
+                                         "path");
+    const QCommandLineOption qrMediaOpt("qr-media",
+                                        "When --pipeline fetches media only used as QR code text: eager, lazy (after the drawn media) or never.",
+                                        "policy");
+    QCommandLineOption workerOpt("worker", "Worker process of --processes, reads tasks from stdin.");
+    workerOpt.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({batchOpt, outOpt, threadsOpt, downloadOpt, noCacheOpt, fontDirOpt, benchResampleOpt, memoryOpt, daemonOpt,
+                       processesOpt, layoutOpt, migrateOpt, migrateBookOpt,
+                       writePackOpt, packOpt, jpegQualityOpt, jpegMaxOpt, jpegPsnrOpt, jpegProgressiveOpt,
+                       pipelineOpt, qrMediaOpt,
+                       workerOpt});
+    parser.process(a);
+
+    if (parser.isSet(memoryOpt)) {
+        MemoryBudget::instance()->setBudget(parser.value(memoryOpt).toLongLong() * 1024 * 1024);
     }
 
     {
-        const auto id = QFontDatabase::addApplicationFont(":/yuanti.ttf");
-        const auto fonts = QFontDatabase::applicationFontFamilies(id);
-        qDebug()<<"fonts: "<<fonts;
+        JpegOptions jpeg;
+        if (parser.isSet(jpegQualityOpt)) {
+            jpeg.quality = parser.value(jpegQualityOpt).toInt();
+        }
+        jpeg.maxBytes = parser.value(jpegMaxOpt).toLongLong() * 1024;
+        jpeg.minPsnr = parser.value(jpegPsnrOpt).toDouble();
+        jpeg.progressive = parser.isSet(jpegProgressiveOpt);
+        JpegEncoder::setDefaultOptions(jpeg);
     }
 
-    {
-        const auto id = QFontDatabase::addApplicationFont(":SourceHanSansCN-Normal.ttf");
-        const auto fonts = QFontDatabase::applicationFontFamilies(id);
-        qDebug()<<"fonts: "<<fonts;
+    if (parser.isSet(layoutOpt)) {
+        bool ok = false;
+        MediaLayout::setDefaultScheme(MediaLayout::schemeFromName(parser.value(layoutOpt), &ok));
+        if (!ok) {
+            qWarning()<<"unknown media layout "<<parser.value(layoutOpt);
+            return 1;
+        }
+    }
+
+    if (parser.isSet(migrateOpt)) {
+        QMultiHash<QString, int> pageIds;
+        if (parser.isSet(migrateBookOpt)) {
+            QString error;
+            const auto data = BookJson::loadData(parser.value(migrateBookOpt), &error);
+            if (data.isEmpty()) {
+                qWarning()<<"can't load "<<parser.value(migrateBookOpt)<<": "<<error;
+                return 1;
+            }
+            pageIds = MediaLayout::pageIds(data);
+        }
+        return MediaLayout::migrate(parser.value(migrateOpt), MediaLayout::defaultScheme(), pageIds) ? 0 : 1;
+    }
+
+    if (parser.isSet(packOpt)) {
+        return MediaPack::writeMediaPath(parser.value(packOpt)) ? 0 : 1;
+    }
+
+    if (parser.isSet(writePackOpt)) {
+        MediaPack::setWriteEnabled(true);
+    }
+
+    if (parser.isSet(benchResampleOpt)) {
+        const QImage img(parser.value(benchResampleOpt));
+        if (img.isNull()) {
+            qWarning()<<"can't load "<<parser.value(benchResampleOpt);
+            return 1;
+        }
+        Resampler::benchmark(img, 5);
+        return 0;
     }
 
+    if (parser.isSet(fontDirOpt)) {
+        FontRegistry::setFontDir(parser.value(fontDirOpt));
+    }
+
+    if (parser.isSet(noCacheOpt)) {
+        BookJson::setCacheEnabled(false);
+    }
+
+    if (parser.isSet(workerOpt)) {
+        return WorkerPool::runWorker();
+    }
+
+    if (parser.isSet(daemonOpt)) {
+        RenderDaemon daemon;
+        if (parser.isSet(threadsOpt)) {
+            daemon.setThreadCount(parser.value(threadsOpt).toInt());
+        }
+        QObject::connect(&daemon, &RenderDaemon::quitRequested,
+                         &a, &QApplication::quit, Qt::QueuedConnection);
+        if (!daemon.listen(parser.value(daemonOpt))) {
+            return 1;
+        }
+        return a.exec();
+    }
+
+    if (parser.isSet(pipelineOpt)) {
+        const auto books = BatchScheduler::booksFor(BatchScheduler::collectBooks(parser.values(pipelineOpt)),
+                                                    parser.value(outOpt));
+        if (parser.value(outOpt).isEmpty() || books.isEmpty()) {
+            qWarning()<<"pipeline mode needs --out and at least one book";
+            return 1;
+        }
+        MediaPipeline pipeline;
+        if (parser.isSet(threadsOpt)) {
+            pipeline.setThreadCount(parser.value(threadsOpt).toInt());
+        }
+        if (parser.isSet(qrMediaOpt)) {
+            const QHash<QString, MediaDownloader::QrMediaPolicy> policies {
+                {"eager", MediaDownloader::QrMediaPolicy::Eager},
+                {"lazy", MediaDownloader::QrMediaPolicy::Lazy},
+                {"never", MediaDownloader::QrMediaPolicy::Never},
+            };
+            if (!policies.contains(parser.value(qrMediaOpt))) {
+                qWarning()<<"unknown QR media policy "<<parser.value(qrMediaOpt);
+                return 1;
+            }
+            pipeline.setQrMediaPolicy(policies.value(parser.value(qrMediaOpt)));
+        }
+        QObject::connect(&pipeline, &MediaPipeline::pipelineError,
+                         &a, [](const QString &msg) {
+            qWarning()<<msg;
+        });
+        QObject::connect(&pipeline, &MediaPipeline::pipelineState,
+                         &a, [](const QString &msg) {
+            qInfo()<<msg;
+        });
+        //started in the event loop, the pipeline's awaitables resume through it
+        QMetaObject::invokeMethod(&a, [&]() {
+            Coro::start(pipeline.run(books), [&](bool ok) {
+                qInfo()<<"jpeg output: "<<JpegEncoder::summary().toString();
+                a.exit(ok ? 0 : 1);
+            });
+        }, Qt::QueuedConnection);
+        return a.exec();
+    }
+
+    if (parser.isSet(batchOpt)) {
+        const auto books = BatchScheduler::booksFor(BatchScheduler::collectBooks(parser.values(batchOpt)),
+                                                    parser.value(outOpt));
+        if (parser.value(outOpt).isEmpty() || books.isEmpty()) {
+            qWarning()<<"batch mode needs --out and at least one book";
+            return 1;
+        }
+        if (parser.isSet(processesOpt)) {
+            if (parser.isSet(downloadOpt)) {
+                qWarning()<<"--download is not supported with --processes, see --pipeline";
+                return 1;
+            }
+            WorkerPool pool;
+            pool.setProcessCount(parser.value(processesOpt).toInt());
+            {
+                //every option that changes how a page renders, workers parse them like this process
+                QStringList args;
+                for (const auto &opt : {fontDirOpt, layoutOpt, jpegQualityOpt, jpegMaxOpt, jpegPsnrOpt}) {
+                    if (parser.isSet(opt)) {
+                        args << "--" + opt.names().first() << parser.value(opt);
+                    }
+                }
+                for (const auto &opt : {noCacheOpt, jpegProgressiveOpt}) {
+                    if (parser.isSet(opt)) {
+                        args << "--" + opt.names().first();
+                    }
+                }
+                //the budget is of all renders, it's split between the workers
+                if (const qint64 mb = parser.value(memoryOpt).toLongLong(); mb > 0) {
+                    args << "--" + memoryOpt.names().first()
+                         << QString::number(qMax<qint64>(1, mb / pool.processCount()));
+                }
+                pool.setWorkerArguments(args);
+            }
+            QObject::connect(&pool, &WorkerPool::bookError,
+                             &a, [&](int book, const QString &msg) {
+                qWarning()<<"book "<<books.at(book).jsonPath<<" error: "<<msg;
+            });
+            QObject::connect(&pool, &WorkerPool::bookFinished,
+                             &a, [&](int book, qint64 msecs) {
+                qInfo()<<"book "<<books.at(book).jsonPath<<" finished in "<<msecs<<" ms";
+            });
+            QObject::connect(&pool, &WorkerPool::finished,
+                             &a, [&](int pages, qint64 msecs) {
+                qInfo()<<"batch finished, "<<pages<<" pages in "<<msecs<<" ms, "
+                        <<pages * 1000.0 / qMax<qint64>(1, msecs)<<" pages/s";
+                qInfo()<<"jpeg output: "<<JpegEncoder::summary().toString();
+                a.quit();
+            }, Qt::QueuedConnection);
+            if (!pool.start(books)) {
+                return 1;
+            }
+            return a.exec();
+        }
+
+        BatchScheduler scheduler;
+        if (parser.isSet(threadsOpt)) {
+            scheduler.setThreadCount(parser.value(threadsOpt).toInt());
+        }
+        scheduler.setDownloadEnabled(parser.isSet(downloadOpt));
+        QObject::connect(&scheduler, &BatchScheduler::bookError,
+                         &a, [&](int book, const QString &msg) {
+            qWarning()<<"book "<<books.at(book).jsonPath<<" error: "<<msg;
+        });
+        QObject::connect(&scheduler, &BatchScheduler::bookFinished,
+                         &a, [&](int book, qint64 msecs) {
+            qInfo()<<"book "<<books.at(book).jsonPath<<" finished in "<<msecs<<" ms";
+        });
+        QObject::connect(&scheduler, &BatchScheduler::finished,
+                         &a, [&](int pages, qint64 msecs) {
+            qInfo()<<"batch finished, "<<pages<<" pages in "<<msecs<<" ms, "
+                    <<pages * 1000.0 / qMax<qint64>(1, msecs)<<" pages/s, peak image memory "
+                    <<MemoryBudget::instance()->peak() / (1024 * 1024)<<" MB";
+            qInfo()<<"jpeg output: "<<JpegEncoder::summary().toString();
+            a.quit();
+        });
+        if (!scheduler.start(books)) {
+            return 1;
+        }
+        return a.exec();
+    }
 
     MainWindow w;
     w.show();